@@ -288,6 +288,40 @@ class MinorCPU(BaseCPU):
     dummy1 = Param.MessageBuffer("dummy1 SPU message buffer")
     dummy2 = Param.MessageBuffer("dummy2 SPU message buffer")
     dummy3 = Param.MessageBuffer("dummy3 SPU message buffer")
+    spuNetInjectWidth = Param.Unsigned(1, "SPU network messages injected"
+        " in a cycle")
+    spuNetCredits = Param.Unsigned(4, "SPU network messages in"
+        " requestFromSpu not taken by the network yet, at most")
+    spuNetQueueDepth = Param.Unsigned(16, "SPU network messages queued"
+        " waiting for a credit, at most; a full queue holds the remote"
+        " reads of the accelerator back")
+    spuNetCoalesceWindow = Param.Unsigned(4, "Latest SPU network messages"
+        " queued checked to coalesce a new one with the same payload into"
+        " a multicast, 0 for no coalescing")
+
+    ssArbiter = Param.String("round-robin", "Policy of arbitrating the"
+        " streams of the stream-dataflow accelerator: round-robin,"
+        " oldest-first, or starvation. Overridden by $DSA_SPEC")
+    ssLaneThreads = Param.Unsigned(0, "Threads to simulate the CGRAs of"
+        " the accelerator lanes in parallel, 0 or 1 for serial."
+        " Overridden by $DSA_SPEC")
+    ssSpadBanks = Param.Unsigned(8, "Banks of each scratchpad of the"
+        " accelerator lanes, a power of 2. Overridden by $DSA_SPEC")
+    ssSpadBankWidth = Param.Unsigned(8, "Bytes of a scratchpad bank line, a"
+        " power of 2 up to 64. Overridden by $DSA_SPEC")
+    ssSpadFifoDepth = Param.Unsigned(1, "Task FIFO depth of each scratchpad"
+        " bank. Overridden by $DSA_SPEC")
+    ssSpadRobSize = Param.Unsigned(4, "Rows of requests buffered by each"
+        " scratchpad. Overridden by $DSA_SPEC")
+    ssSpadIssueWidth = Param.Unsigned(16, "Requests checked to issue to the"
+        " scratchpad banks in a cycle. Overridden by $DSA_SPEC")
+    ssSpadProvision = Param.Unsigned(1, "Requests each scratchpad bank takes"
+        " from the input buffer in a cycle. Overridden by $DSA_SPEC")
+    ssSpadBuffer = Param.String("input", "Request buffer of the scratchpads:"
+        " input, or link. Overridden by $DSA_SPEC")
+    ssFastForward = Param.Bool(False, "Serve the memory requests of the"
+        " stream commands functionally before the first ROI; the lanes are"
+        " still stepped cycle by cycle. Overridden by $DSA_SPEC")
 
     def addCheckerCpu(self):
         print("Checker not yet supported by MinorCPU")
@@ -41,6 +41,7 @@
 #include "cpu/minor/dyn_inst.hh"
 #include "cpu/minor/fetch1.hh"
 #include "cpu/minor/pipeline.hh"
+#include "cpu/minor/spu_endpoint.hh"
 #include "debug/Drain.hh"
 #include "debug/MinorCPU.hh"
 #include "debug/Quiesce.hh"
@@ -86,6 +87,7 @@ MinorCPU::MinorCPU(MinorCPUParams *params) :
 
     pipeline = new Minor::Pipeline(*this, *params);
     activityRecorder = pipeline->getActivityRecorder();
+    pipeline->getSSIM().exportStats(this);
 
 	// does it work like get()?
 	// printf("Number of accel in the system are: %d\n",params->numThreads);
@@ -94,6 +96,9 @@ MinorCPU::MinorCPU(MinorCPUParams *params) :
 	dummy1 = params->dummy1;
 	dummy2 = params->dummy2;
 	dummy3 = params->dummy3;
+    spuEndpoint = new Minor::SpuEndpoint(*this, requestFromSpu,
+        params->spuNetInjectWidth, params->spuNetCredits,
+        params->spuNetQueueDepth, params->spuNetCoalesceWindow);
 
 	// FIXME: might need to add this (let's keep it added actually)
 	// will be useful for getDest, etc
@@ -250,6 +255,7 @@ void MinorCPU::wakeup()
     else {
       assert(0 && "unknown SPU message type");
     }
+    spuEndpoint->receive(*msg);
     responseToSpu->dequeue(clockEdge());
     // for global barrier
     ThreadContext *thread = getContext(0); // assume tid=0?
@@ -266,6 +272,7 @@ void MinorCPU::print(std::ostream& out) const
 MinorCPU::~MinorCPU()
 {
     delete pipeline;
+    delete spuEndpoint;
 
     for (ThreadID thread_id = 0; thread_id < threads.size(); thread_id++) {
         delete threads[thread_id];
@@ -318,6 +325,7 @@ void
 MinorCPU::serialize(CheckpointOut &cp) const
 {
     pipeline->serialize(cp);
+    pipeline->getSSIM().serializeSection(cp, "ssim");
     BaseCPU::serialize(cp);
 }
 
@@ -325,6 +333,10 @@ void
 MinorCPU::unserialize(CheckpointIn &cp)
 {
     pipeline->unserialize(cp);
+    /* A checkpoint taken by another CPU model has no accelerator state,
+     *  so the accelerator starts afresh */
+    if (cp.sectionExists(Serializable::currentSection() + ".ssim"))
+        pipeline->getSSIM().unserializeSection(cp, "ssim");
     BaseCPU::unserialize(cp);
 }
 
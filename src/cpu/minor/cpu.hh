@@ -66,6 +66,7 @@ namespace Minor
 /** Forward declared to break the cyclic inclusion dependencies between
  *  pipeline and cpu */
 class  Pipeline;
+class  SpuEndpoint;
 
 /** Minor will use the SimpleThread state for now */
 typedef SimpleThread MinorThread;
@@ -146,7 +147,10 @@ class MinorCPU : public BaseCPU, public Consumer
 	MessageBuffer *dummy3;
 	MachineID m_machineID;
 
-
+  public:
+    /** The endpoint of the accelerator on the SPU network, injecting into
+     *  requestFromSpu */
+    Minor::SpuEndpoint *spuEndpoint;
 
   public:
     MinorCPU(MinorCPUParams *params);
@@ -494,6 +494,9 @@ class ExecContext : public ::ExecContext
       DPRINTF(SS, "Do SS_COMMAND %d.\n", SSCmdNames[ss_func_opcode]);
       ssim_t& ssim = execute.getSSIM();
       ssim.inst = inst;
+      ssim.FastForward(thread.getTC()->getVirtProxy());
+      // Credit the skipped cycles before the command changes the state of the lanes.
+      ssim.WakeUp();
       switch(ss_func_opcode) {
         case SS_BEGIN_ROI:
           PseudoInst::resetstats(thread.getTC(), 0, clock());
@@ -580,6 +583,9 @@ class ExecContext : public ::ExecContext
           break;
       }
       ssim.resetNonStickyState();
+      if (ssim.Functional()) {
+        ssim.RunFunctional();
+      }
     }
 #endif
 
@@ -44,6 +44,7 @@
 #include "cpu/minor/exec_context.hh"
 #include "cpu/minor/fetch1.hh"
 #include "cpu/minor/lsq.hh"
+#include "cpu/minor/spu_endpoint.hh"
 #include "cpu/op_class.hh"
 #include "debug/Activity.hh"
 #include "debug/Branch.hh"
@@ -96,7 +97,7 @@ Execute::Execute(const std::string &name_,
         params.executeLSQTransfersQueueSize,
         params.executeLSQStoreBufferSize,
         params.executeLSQMaxStoreBufferStoresPerCycle),
-    ssim(&lsq),
+    ssim(&lsq, params),
     executeInfo(params.numThreads, ExecuteThreadInfo(params.executeCommitLimit)),
     interruptPriority(0),
     issuePriority(0),
@@ -1686,6 +1687,7 @@ bool Execute::push_rem_read_req(int dest_core_id, int request_ptr, int addr, int
     val[j+1] = (req_core >> (j*8)) & 65535;
   }
   spu_req_info req(1, val, 9, addr_to_send, mcast_dest, req_type);
+  req.control = true;
   push_net_req(req);
   
   return true;
@@ -1699,7 +1701,6 @@ void Execute::push_net_req(spu_req_info req) {
     assert(req.mcast_dest[0]<=ssim.num_active_threads());
     split_count++;
     std::shared_ptr<SpuRequestMsg> msg = std::make_shared<SpuRequestMsg>(cpu.clockEdge());
-    (*msg).m_MessageSize = MessageSizeType_Control;
     (*msg).m_Requestor = cpu.get_m_version();
     switch(req.type) {
       case 0: (*msg).m_Type = SpuRequestType_LD;
@@ -1712,6 +1713,14 @@ void Execute::push_net_req(spu_req_info req) {
     }
     (*msg).m_addr = req.addr_to_send;
     int bytes_to_send = std::min(SPU_NET_PACKET_SIZE, req.num_data_bytes);
+    // The payload wider than a control message occupies the network as data, except the
+    // read requests, which only carry the requesting core.
+    if (bytes_to_send > (int) Network::MessageSizeType_to_int(MessageSizeType_Control) &&
+        !req.control) {
+      (*msg).m_MessageSize = MessageSizeType_Data;
+    } else {
+      (*msg).m_MessageSize = MessageSizeType_Control;
+    }
     for(j=0; j<bytes_to_send; ++j){ // non-zero if data-request
       (*msg).m_DataBlk.setByte(j,req.data[j]);
     }
@@ -1723,29 +1732,24 @@ void Execute::push_net_req(spu_req_info req) {
       // std::cout << "mast dest: " << req.mcast_dest[j] << "\n";
       (*msg).m_Destination.add(cpu.get_m_version(req.mcast_dest[j]));
     }
-    _pending_net_req.push(std::make_pair(msg,req.num_dest)); // ordering may be changed
+    cpu.spuEndpoint->push(msg, req.num_dest);
     req.num_data_bytes -= bytes_to_send;
     req.data += bytes_to_send;
   }
   // std::cout << "Split count this cycle: " << split_count << "\n";
 }
 
-// TODO: this should be called at each network cycle not spu?
-void Execute::serve_pending_net_req() {
-  // requires some condition if this can be accepted or not..
-  // check if a control or data message
-  if(!_pending_net_req.empty()) {
+bool Execute::can_push_net_req(int num_data_bytes) {
+  // push_net_req splits the payload into packets, each of which is queued.
+  return cpu.spuEndpoint->canPush((num_data_bytes + SPU_NET_PACKET_SIZE - 1) / SPU_NET_PACKET_SIZE);
+}
 
-    DSA_LOG(NET_REQ) << "Issuing SPU network request from core: " << cpu.cpuId() << " at cycle: " << cpu.curCycle();
+void Execute::serve_pending_net_req() {
+  cpu.spuEndpoint->inject();
+}
 
-    ThreadContext *thread = cpu.getContext(0); // assume tid=0?
-    for(int i=0; i<_pending_net_req.front().second; ++i) {
-      thread->getSystemPtr()->inc_spu_sent();
-    }
-    // somehow we modified enqueue time
-    cpu.pushReqFromSpu(_pending_net_req.front().first);
-    _pending_net_req.pop();
-  }
+bool Execute::is_pending_net_empty() {
+  return cpu.spuEndpoint->empty();
 }
 
 
@@ -2491,6 +2495,10 @@ Execute::isDrained()
     if (!lsq.isDrained())
         return false;
 
+    /* The in-flight streams of the accelerator are not checkpointed */
+    if (!ssim.drained())
+        return false;
+
     for (ThreadID tid = 0; tid < cpu.numThreads; tid++) {
         if (!inputBuffer[tid].empty() ||
             !executeInfo[tid].inFlightInsts->empty()) {
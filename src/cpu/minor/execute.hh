@@ -159,6 +159,7 @@ class Execute : public Named
       uint32_t addr_to_send;
       int *mcast_dest;
       int type; // 0 for ld, 1 for st, 2 for update
+      bool control{false}; // the payload only tells the requesting core, as a remote read
 
       spu_req_info(int nd, int8_t *d, int db, uint32_t addr, int *mdest, int t) {
         num_dest=nd;
@@ -175,7 +176,6 @@ class Execute : public Named
       spu_req_info() {}
     };
 
-    std::queue<std::pair<std::shared_ptr<SpuRequestMsg>,int>> _pending_net_req;
     int _last_tag=-1;
     /** Input port carrying instructions from Decode */
     Latch<ForwardInstData>::Output inp;
@@ -480,11 +480,9 @@ class Execute : public Named
     bool push_rem_read_req(int dest_core_id, int request_ptr, int addr, int data_bytes, int reorder_entry);
 
   void push_net_req(spu_req_info req);
+  bool can_push_net_req(int num_data_bytes);
   void serve_pending_net_req();
-  bool is_pending_net_empty() { 
-    // std::cout << "Number of pending req at core: " << cpu.cpuId() << " is: " << _pending_net_req.size() << "\n";
-    return _pending_net_req.empty(); 
-  }
+  bool is_pending_net_empty();
   void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr, int data_bytes, int reorder_entry);
     void receiveSpuReadRequest(int req_core, int request_ptr, int addr, int data_bytes, int reorder_entry) {
       ssim.push_ind_rem_read_req(true, req_core, request_ptr, addr, data_bytes, reorder_entry);
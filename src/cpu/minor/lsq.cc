@@ -1426,6 +1426,10 @@ void LSQ::push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, i
   execute.push_rem_read_return(dst_core, data, request_ptr, addr, data_bytes, reorder_entry);
 }
 
+bool LSQ::can_push_net_req(int num_data_bytes) {
+  return execute.can_push_net_req(num_data_bytes);
+}
+
 void LSQ::serve_pending_net_req() {
   execute.serve_pending_net_req();
 }
@@ -1570,7 +1574,7 @@ LSQ::LSQ(std::string name_, std::string dcache_port_name_,
      * 1. The number of streams supported (currently 100, too high)
      * 2. The size of each transfer queue (currently identical to transfers)
      */
-    for(int i = 0; i <= 128; ++i) {
+    for(int i = 0; i <= SS_PREFETCH_QUEUE; ++i) {
         //Logically this would be implemented with a single queue
       // sd_transfers.emplace_back(name_ + ".sd_transfers", "addr", 21);
       sd_transfers.emplace_back(name_ + ".sd_transfers", "addr", 32);
@@ -1613,7 +1617,7 @@ LSQ::~LSQ()
 LSQ::LSQRequest::~LSQRequest()
 {
     if (sdInfo)
-        delete sdInfo;
+        dsa::sim::Release(sdInfo);
     if (packet)
         delete packet;
     if (data)
@@ -52,6 +52,11 @@
 
 #include "ssim/linear_stream.h"
 
+namespace dsa {
+namespace sim {
+struct ReqInfoPool;
+}
+}
 
 struct SSMemReqInfo {
   /*!
@@ -70,12 +75,25 @@ struct SSMemReqInfo {
   /*!
    * \brief The bitmask applied on the memory.
    */
-  std::vector<bool> mask;
+  dsa::sim::ByteMask mask;
   /*!
    * \brief TODO(@were): Deprecate this. This is for indirect memory, but can already be covered
    *        by the mask.
    */
   std::vector<int> map;
+  /*!
+   * \brief If this is a line of an indirect gather, staged until the last line arrives.
+   *        Only the last line carries the map, which indexes the lines staged in order.
+   */
+  bool gather{false};
+  /*!
+   * \brief If this is a prefetch hint of a stream, whose response carries no data for the ports.
+   */
+  bool prefetch{false};
+  /*!
+   * \brief If the line was prefetched before this demand request, to tell the timeliness.
+   */
+  bool prefetched{false};
   /*!
    * \brief The status of the stream that generates this request.
    */
@@ -96,10 +114,18 @@ struct SSMemReqInfo {
    * \brief The time breakdown of profiling the life of a request to response.
    */
   int64_t breakdown[11];
+  /*!
+   * \brief The pool this record is recycled to, or nullptr if it is deleted when released.
+   */
+  dsa::sim::ReqInfoPool *pool{nullptr};
+  /*!
+   * \brief If this record is released to the pool, to catch the use after it.
+   */
+  bool released{false};
 
   // mask: dma direct read
   SSMemReqInfo(int stream_id_, uint64_t which_accel_, const std::vector<int> ports_,
-      const std::vector<bool>& mask_, int64_t request_cycle_,
+      const dsa::sim::ByteMask& mask_, int64_t request_cycle_,
       const dsa::sim::stream::AffineStatus &as_)
       : stream_id(stream_id_), trans_idx(ports_[0]),
       ports(ports_), mask(mask_), as(as_), which_accel(which_accel_),
@@ -113,6 +139,11 @@ struct SSMemReqInfo {
 };
 typedef SSMemReqInfo *SSMemReqInfoPtr;
 
+/*!
+ * \brief The transfer queue of the stream prefetch hints, after those of the ports.
+ */
+const int SS_PREFETCH_QUEUE = 129;
+
 namespace Minor
 {
 
@@ -808,6 +839,7 @@ class LSQ : public Named
     bool push_rem_atom_op_req(uint64_t val, std::vector<int> update_broadcast_dest, std::vector<int> _update_coalesce_vals, int opcode, int val_bytes, int out_bytes);
     bool push_rem_read_req(int dest_core_id, int request_ptr, int addr, int data_bytes, int reorder_entry);
     void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr, int data_bytes, int reorder_entry);
+    bool can_push_net_req(int num_data_bytes);
     void serve_pending_net_req();
     void check_cpu_response_queue() { cpu.wakeup(); }
     bool is_pending_net_empty();
@@ -131,6 +131,8 @@ class Pipeline : public Ticked {
       return execute.getSSIM().pending_request_queue_full();
     }
 
+    ssim_t &getSSIM() { return execute.getSSIM(); }
+
 
 
 
@@ -0,0 +1,136 @@
+#include "cpu/minor/spu_endpoint.hh"
+
+#include "cpu/minor/cpu.hh"
+#include "dsa/debug.h"
+#include "sim/system.hh"
+
+namespace Minor
+{
+
+SpuEndpoint::SpuEndpoint(MinorCPU &cpu_, MessageBuffer *to_network,
+    unsigned int inject_width, unsigned int credits_,
+    unsigned int queue_depth, unsigned int coalesce_window) :
+    Stats::Group(&cpu_, "spuNet"),
+    cpu(cpu_),
+    toNetwork(to_network),
+    injectWidth(inject_width),
+    credits(credits_),
+    queueDepth(queue_depth),
+    coalesceWindow(coalesce_window),
+    lastCycle(0),
+    injectedThisCycle(0),
+    lastStall(0),
+    ADD_STAT(messages, "Messages queued to the SPU network"),
+    ADD_STAT(coalesced, "Messages coalesced into another one queued"),
+    ADD_STAT(injected, "Messages injected into the SPU network"),
+    ADD_STAT(deliveries, "Destinations of the messages injected"),
+    ADD_STAT(creditStalls, "Cycles a message is held back by no credit"),
+    ADD_STAT(queueStalls, "Messages held back by their producer for a full"
+        " queue"),
+    ADD_STAT(received, "Messages received from the SPU network"),
+    ADD_STAT(latency, "Cycles from queuing a message to receiving it")
+{
+    if (injectWidth < 1)
+        fatal("%s: spuNetInjectWidth must be >= 1\n", cpu.name());
+    if (credits < 1)
+        fatal("%s: spuNetCredits must be >= 1\n", cpu.name());
+    if (queueDepth < 1)
+        fatal("%s: spuNetQueueDepth must be >= 1\n", cpu.name());
+
+    latency.init(16).flags(Stats::pdf | Stats::nozero);
+}
+
+bool
+SpuEndpoint::canPush(unsigned int n)
+{
+    if (pending.size() + n <= queueDepth)
+        return true;
+    ++queueStalls;
+    return false;
+}
+
+void
+SpuEndpoint::push(std::shared_ptr<SpuRequestMsg> msg, int num_dest)
+{
+    ++messages;
+
+    unsigned int scanned = 0;
+    for (auto i = pending.rbegin();
+        i != pending.rend() && scanned < coalesceWindow; ++i, ++scanned)
+    {
+        SpuRequestMsg &other = *i->msg;
+        bool disjoint =
+            !other.m_Destination.intersectionIsNotEmpty(msg->m_Destination);
+
+        if (disjoint && other.m_Type == msg->m_Type &&
+            other.m_addr == msg->m_addr &&
+            other.m_MessageSize == msg->m_MessageSize &&
+            other.m_DataBlk == msg->m_DataBlk)
+        {
+            other.m_Destination.addNetDest(msg->m_Destination);
+            i->numDest += num_dest;
+            ++coalesced;
+            DSA_LOG(NET_REQ) << "Coalesced a message to " << num_dest
+                << " destination(s) into one to " << i->numDest;
+            return;
+        }
+
+        /* The message cannot overtake one to the same destination */
+        if (!disjoint)
+            break;
+    }
+
+    panic_if(full(), "%s: SPU network message queued beyond %d, not "
+        "checked by canPush\n", cpu.name(), queueDepth);
+    pending.push_back({msg, num_dest});
+}
+
+void
+SpuEndpoint::inject()
+{
+    Cycles now = cpu.curCycle();
+    if (now != lastCycle) {
+        lastCycle = now;
+        injectedThisCycle = 0;
+    }
+
+    while (!pending.empty() && injectedThisCycle < injectWidth) {
+        /* The size is sampled at the first check in a cycle, so the
+         *  messages injected since are added */
+        Tick edge = cpu.clockEdge();
+        if (toNetwork->getSize(edge) + injectedThisCycle >= credits ||
+            !toNetwork->areNSlotsAvailable(1, edge))
+        {
+            /* Count a stall once, however many lanes try in the cycle */
+            if (lastStall != now) {
+                lastStall = now;
+                ++creditStalls;
+            }
+            return;
+        }
+
+        Pending &front = pending.front();
+
+        DSA_LOG(NET_REQ) << "Issuing SPU network request from core: "
+            << cpu.cpuId() << " at cycle: " << now;
+
+        /* The global barrier waits for each destination to receive it */
+        for (int i = 0; i < front.numDest; ++i)
+            cpu.system->inc_spu_sent();
+
+        deliveries += front.numDest;
+        ++injected;
+        cpu.pushReqFromSpu(front.msg);
+        pending.pop_front();
+        ++injectedThisCycle;
+    }
+}
+
+void
+SpuEndpoint::receive(const SpuRequestMsg &msg)
+{
+    ++received;
+    latency.sample(cpu.ticksToCycles(curTick() - msg.getTime()));
+}
+
+}
@@ -0,0 +1,123 @@
+/**
+ * @file
+ *
+ *  The endpoint of the accelerator on the SPU network, which carries the
+ *  remote scratchpad reads and writes, and the port multicasts among the
+ *  cores.
+ */
+
+#ifndef __CPU_MINOR_SPU_ENDPOINT_HH__
+#define __CPU_MINOR_SPU_ENDPOINT_HH__
+
+#include <deque>
+#include <memory>
+
+#include "base/statistics.hh"
+#include "base/stats/group.hh"
+#include "base/types.hh"
+#include "mem/ruby/network/MessageBuffer.hh"
+#include "mem/ruby/protocol/SpuRequestMsg.hh"
+
+class MinorCPU;
+
+namespace Minor
+{
+
+/** The messages of the accelerator are queued here, and injected into the
+ *  Ruby network through the requestFromSpu buffer of the CPU, which is
+ *  routed by the topology of the network to the destinations.
+ *
+ *  A message is injected only with a credit, one for each slot the
+ *  network has not drained from the buffer yet, and at most queueDepth
+ *  messages wait for one.  The producers check canPush before they queue,
+ *  so a congested network holds the accelerator back instead of growing
+ *  either the buffer or the queue.  A message
+ *  with the same payload as one still queued, but to other destinations,
+ *  is coalesced into it and multicast, unless a message between the two
+ *  goes to any of those destinations, which would reorder them. */
+class SpuEndpoint : public Stats::Group
+{
+  protected:
+    struct Pending
+    {
+        std::shared_ptr<SpuRequestMsg> msg;
+        /** The number of destinations, counted by the global barrier */
+        int numDest;
+    };
+
+    /** The CPU whose accelerator this is */
+    MinorCPU &cpu;
+
+    /** The buffer drained by the network */
+    MessageBuffer *toNetwork;
+
+    /** Messages injected in a cycle at most */
+    unsigned int injectWidth;
+
+    /** Messages in the buffer not taken by the network at most */
+    unsigned int credits;
+
+    /** Messages queued not injected yet at most */
+    unsigned int queueDepth;
+
+    /** The latest messages queued checked to coalesce a new one, 0 for
+     *  no coalescing */
+    unsigned int coalesceWindow;
+
+    /** The messages not injected yet, in the order to inject */
+    std::deque<Pending> pending;
+
+    /** The cycle of the messages injected in injectedThisCycle */
+    Cycles lastCycle;
+    unsigned int injectedThisCycle;
+
+    /** The last cycle counted in creditStalls */
+    Cycles lastStall;
+
+  public:
+    /** Messages queued */
+    Stats::Scalar messages;
+    /** Messages coalesced into another one queued */
+    Stats::Scalar coalesced;
+    /** Messages injected into the network */
+    Stats::Scalar injected;
+    /** Destinations of the messages injected */
+    Stats::Scalar deliveries;
+    /** Cycles a message queued is held back by no credit */
+    Stats::Scalar creditStalls;
+    /** Messages held back by their producer for a full queue */
+    Stats::Scalar queueStalls;
+    /** Messages received from the network */
+    Stats::Scalar received;
+    /** Cycles from queuing a message to receiving it */
+    Stats::Histogram latency;
+
+  public:
+    SpuEndpoint(MinorCPU &cpu_, MessageBuffer *to_network,
+        unsigned int inject_width, unsigned int credits_,
+        unsigned int queue_depth, unsigned int coalesce_window);
+
+    /** If n more messages can be queued.  A producer held back by it is
+     *  counted in queueStalls */
+    bool canPush(unsigned int n = 1);
+
+    /** If no more message can be queued */
+    bool full() const { return pending.size() >= queueDepth; }
+
+    /** Queue a message to the destinations set in it, which the producer
+     *  has checked by canPush */
+    void push(std::shared_ptr<SpuRequestMsg> msg, int num_dest);
+
+    /** Inject the oldest messages, as the credits and the width allow */
+    void inject();
+
+    /** If all the messages are injected */
+    bool empty() const { return pending.empty(); }
+
+    /** Account a message received from the network */
+    void receive(const SpuRequestMsg &msg);
+};
+
+}
+
+#endif /* __CPU_MINOR_SPU_ENDPOINT_HH__ */
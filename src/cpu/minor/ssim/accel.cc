@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <unordered_set>
 #include <utility>
 #include <sstream>
@@ -28,16 +30,6 @@ const char *BLAME_NAME[] = {
 #undef MACRO
 };
 
-std::vector<uint8_t> apply_mask(const uint8_t *raw_data, vector<bool> mask) {
-  std::vector<uint8_t> res;
-  for (int i = 0; i < mask.size(); ++i) {
-    if (mask[i]) {
-      res.push_back(raw_data[i]);
-    }
-  }
-  return res;
-}
-
 int accel_t::get_cur_cycle() {
   return now() - _ssim->roi_enter_cycle();
 }
@@ -152,6 +144,9 @@ void accel_t::request_reset_streams() {
   _dma_c.reset_data();
   _scr_w_c.reset_data();
   _net_c.reset_data();
+  if (prefetcher) {
+    prefetcher->Reset();
+  }
 
   _stream_cleanup_mode=false;
   _cleanup_mode = true; // it should wait for outstanding mem req to be done (wait on o/p ports and then cleanup memory)
@@ -174,6 +169,9 @@ void accel_t::reset_data() {
   _dma_c.reset_data();
   _scr_w_c.reset_data();
   _net_c.reset_data();
+  if (prefetcher) {
+    prefetcher->Reset();
+  }
 
 }
 
@@ -184,20 +182,35 @@ uint64_t accel_t::now() {
   return get_ssim()->now();
 }
 
-Minor::LSQ *accel_t::lsq() {
+dsa::sim::MemoryInterface *accel_t::lsq() {
   return get_ssim()->lsq();
 }
 
 accel_t::accel_t(int i, ssim_t *ssim)
-    : arbiter(new dsa::sim::RoundRobin()),
+    : arbiter(dsa::sim::StreamArbiter::Create(ssim->spec.arbiter)),
       statistics(*this),
       _ssim(ssim), _accel_index(i), _accel_mask(1 << i),
       _dma_c(this, &_scr_r_c, &_scr_w_c, &_net_c), _scr_r_c(this, &_dma_c),
       _scr_w_c(this, &_dma_c), _net_c(this, &_dma_c) {
 
+  tracer = ssim->trace.get();
+
+  auto &spec = ssim->spec;
   spads.reserve(2);
-  spads.emplace_back(8, 8, SCRATCH_SIZE, 1, new dsa::sim::InputBuffer(4, 16, 1));
-  spads.emplace_back(8, 8, SCRATCH_SIZE, 1, new dsa::sim::InputBuffer(4, 16, 1));
+  for (int j = 0; j < 2; ++j) {
+    auto *rb = dsa::sim::RequestBuffer::Create(spec.spad_buffer, spec.spad_rob_size,
+                                               spec.spad_issue_width, spec.spad_provision,
+                                               spec.spad_banks);
+    spads.emplace_back(spec.spad_bank_width, spec.spad_banks, SCRATCH_SIZE,
+                       spec.spad_fifo_depth, rb);
+  }
+  if (spec.race_check) {
+    race.reset(new dsa::sim::RaceDetector(spec.spad_bank_width));
+  }
+  if (spec.dma_prefetch_distance > 0) {
+    prefetcher.reset(new dsa::sim::StreamPrefetcher(spec.dma_bandwidth, spec.dma_prefetch_distance,
+                                                    spec.dma_prefetch_outstanding));
+  }
 
   ENFORCED_SYSTEM("mkdir -p stats/");
   ENFORCED_SYSTEM("mkdir -p viz/");
@@ -252,18 +265,12 @@ accel_t::accel_t(int i, ssim_t *ssim)
   scratchpad.resize(SCRATCH_SIZE);
   if (_linear_spad) {
     scratchpad.resize(SCRATCH_SIZE + LSCRATCH_SIZE);
-    // scratchpad_readers.resize(SCRATCH_SIZE+LSCRATCH_SIZE);
-    // scratchpad_writers.resize(SCRATCH_SIZE+LSCRATCH_SIZE);
   }
 
   if(lsq()->getCpuId() == 0) { // single-core simulation
     _ssim->set_num_active_threads(1);
   }
 
-  // optionally used -- this is expensive
-  // TODO: make it compat with linear scr case
-  scratchpad_readers.resize(SCRATCH_SIZE);
-  scratchpad_writers.resize(SCRATCH_SIZE);
 
   // FIXME(@were): Implicit streams for remote spad access.
   // if (i == 0) { // required only in 1st accel
@@ -516,7 +523,7 @@ struct StreamExecutor : dsa::sim::stream::Functor {
     res.insert(res.begin(), before.begin(), before.end());
     std::vector<uint8_t> after(info.mask.size() - res.size(), 0);
     res.insert(res.end(), after.begin(), after.end());
-    DSA_CHECK(res.size() == info.mask.size());
+    DSA_CHECK((int) res.size() == info.mask.size());
     return res;
   }
 
@@ -527,7 +534,7 @@ struct StreamExecutor : dsa::sim::stream::Functor {
    */
   int canRequest(LOC loc, int port, int mem_idx) {
     if (loc == LOC::DMA) {
-      if (accel->lsq()->sd_transfers[port].unreservedRemainingSpace() &&
+      if (accel->lsq()->transferAvailable(port) &&
           accel->lsq()->canRequest()) {
         return accel->get_ssim()->spec.dma_bandwidth;
       }
@@ -543,8 +550,20 @@ struct StreamExecutor : dsa::sim::stream::Functor {
     return -1;
   }
 
+  /*!
+   * \brief The kind of scratchpad access of the memory operation for race checking.
+   */
+  static dsa::sim::RaceDetector::Kind raceKind(MemoryOperation mo) {
+    if (mo == MemoryOperation::DMO_Read) {
+      return dsa::sim::RaceDetector::Read;
+    }
+    return mo == MemoryOperation::DMO_Write ? dsa::sim::RaceDetector::Write
+                                            : dsa::sim::RaceDetector::Atomic;
+  }
+
   void makeMemoryRequest(base_stream_t *s, const std::vector<uint8_t> &data, const std::vector<int> &ports,
-                         dsa::sim::stream::LinearStream::LineInfo info, MemoryOperation mo) {
+                         dsa::sim::stream::LinearStream::LineInfo info, MemoryOperation mo,
+                         bool prefetched = false) {
     accel->statistics.countDataTraffic(MemoryOperation::DMO_Read == mo, s->unit(), info.bytes_read());
     int read = mo == DMO_Read;
     if (read) {
@@ -552,7 +571,7 @@ struct StreamExecutor : dsa::sim::stream::Functor {
       reserveBuffers(ports, to_reserve);
     }
     if (s->side(read) == LOC::DMA) {
-      makeDMARequest(s->id(), s->inst, mo, ports, data, info);
+      makeDMARequest(s->id(), s->inst, mo, ports, data, info, prefetched);
     } else {
       auto padded = data;
       if (!padded.empty()) {
@@ -564,34 +583,96 @@ struct StreamExecutor : dsa::sim::stream::Functor {
       int spad_idx = spad_idx0;
       DSA_CHECK(spad_idx >= 0 && spad_idx < accel->spads.size());
       accel->spads[spad_idx].rb->Decode(&accel->spads[spad_idx], ports[0], mo, info, padded);
+      if (auto *race = accel->race.get()) {
+        race->Access(s->id(), s->barrier_mask(), spad_idx, info.linebase, info.mask, raceKind(mo));
+      }
+      if (auto *t = accel->tracer) {
+        t->Request(accel->now(), accel->accel_index(), s->id(), ports[0], LOC::SCR, info.start,
+                   read ? info.bytes_read() : data.size(), read);
+      }
     }
   }
 
   void makeDMARequest(int sid, Minor::MinorDynInstPtr inst, MemoryOperation op,
                       const std::vector<int> &ports,
                       const std::vector<uint8_t> &data,
-                      const dsa::sim::stream::LinearStream::LineInfo &info) {
+                      const dsa::sim::stream::LinearStream::LineInfo &info,
+                      bool prefetched = false) {
     bool read = op == MemoryOperation::DMO_Read;
-    auto *sdInfo = new SSMemReqInfo(sid, accel->accel_index(), ports,
-                                    read ? info.mask : std::vector<bool>(),
-                                    accel->now(), info.as);
+    auto *sdInfo = accel->req_pool.Acquire(sid, accel->accel_index(), ports,
+                                           read ? info.mask : dsa::sim::ByteMask(),
+                                           accel->now(), info.as);
+    sdInfo->prefetched = prefetched;
     if (read) {
-      accel->lsq()->sd_transfers[ports[0]].reserve();
+      accel->lsq()->reserveTransfer(ports[0]);
     }
     int size = read ? info.mask.size() : data.size();
     auto address = read ? info.linebase : info.start;
     // make request
     accel->lsq()->pushRequest(inst, /*isLoad*/op == MemoryOperation::DMO_Read,
                               /*data*/read ? nullptr : const_cast<uint8_t*>(data.data()),
-                              /*size in bytes*/size, /*addr*/address, /*flags*/0,
-                              /*res*/0, /*atomic op*/nullptr, /*byte enable*/std::vector<bool>(),
-                              sdInfo);
+                              /*size in bytes*/size, /*addr*/address, sdInfo);
+    if (auto *t = accel->tracer) {
+      t->Request(accel->now(), accel->accel_index(), sid, ports[0], LOC::DMA, address,
+                 read ? info.bytes_read() : size, read);
+    }
     DSA_LOG(MEM_REQ)
       << accel->get_ssim()->now() << ": "
       << (read ? "Read" : "Write") << " request: " << info.linebase << ", " << info.start
       << (info.as.stream_last ? ", last request of stream" : "");
   }
 
+  /*!
+   * \brief Request a line of an indirect gather, whose response is staged by the DMA controller.
+   *        The last line of the gather is given the map of the elements after all the lines
+   *        are requested.
+   */
+  SSMemReqInfo *makeGatherRequest(int sid, Minor::MinorDynInstPtr inst,
+                                  const std::vector<int> &ports, int64_t linebase) {
+    auto *sdInfo = accel->req_pool.Acquire(sid, accel->accel_index(), ports,
+                                           dsa::sim::ByteMask(), accel->now(),
+                                           dsa::sim::stream::AffineStatus());
+    sdInfo->gather = true;
+    accel->lsq()->reserveTransfer(ports[0]);
+    accel->lsq()->pushRequest(inst, /*isLoad*/true, /*data*/nullptr,
+                              /*size in bytes*/accel->get_ssim()->spec.dma_bandwidth,
+                              /*addr*/linebase, sdInfo);
+    DSA_LOG(MEM_REQ) << accel->get_ssim()->now() << ": Gather request: " << linebase;
+    return sdInfo;
+  }
+
+  /*!
+   * \brief Hint the cache hierarchy of the lines looked ahead of the affine read stream,
+   *        until the stream is the distance ahead, or the prefetches or the LSQ are full.
+   * \param cycle The current cycle.
+   */
+  void prefetchAhead(LinearReadStream *lrs, dsa::sim::StreamPrefetcher *prefetcher, int64_t cycle) {
+    if (!lrs->stream_active()) {
+      prefetcher->Retire(lrs->id());
+      return;
+    }
+    auto *lsq = accel->lsq();
+    static const std::vector<int> PREFETCH_PORTS = {SS_PREFETCH_QUEUE};
+    while (lsq->canRequest() && lsq->transferAvailable(SS_PREFETCH_QUEUE)) {
+      int64_t linebase = prefetcher->Next(lrs->id(), cycle);
+      if (linebase == -1) {
+        return;
+      }
+      auto *sdInfo = accel->req_pool.Acquire(lrs->id(), accel->accel_index(), PREFETCH_PORTS,
+                                             dsa::sim::ByteMask(), accel->now(),
+                                             dsa::sim::stream::AffineStatus());
+      sdInfo->prefetch = true;
+      lsq->reserveTransfer(SS_PREFETCH_QUEUE);
+      lsq->pushRequest(lrs->inst, /*isLoad*/true, /*data*/nullptr,
+                       /*size in bytes*/accel->get_ssim()->spec.dma_bandwidth,
+                       /*addr*/linebase, sdInfo);
+      if (accel->in_roi()) {
+        ++accel->_stat_prefetch_issued;
+      }
+      DSA_LOG(MEM_REQ) << accel->get_ssim()->now() << ": Prefetch request: " << linebase;
+    }
+  }
+
   void Visit(ConstPortStream *cps) override {
     auto &stream = *cps;
     int pushed = 0;
@@ -667,13 +748,28 @@ struct StreamExecutor : dsa::sim::stream::Functor {
     }
     auto info = stream.ls->cacheline(cacheline, available, stream.be, DMO_Read, stream.src());
     info.as.padding = (Padding) stream.padding;
-    std::vector<bool> bm = info.mask;
     std::vector<int> ports;
     for (auto &elem : stream.pes) {
       ports.push_back(elem.port);
     }
-    makeMemoryRequest(lrs, {}, ports, info, DMO_Read);
-    int total_bytes = std::accumulate(bm.begin(), bm.end(), 0);
+    // The scratchpad streams and the buffets are not prefetched,
+    // nor are the functional runs, which have no timing to hide.
+    auto *prefetcher = stream.src() == LOC::DMA && !stream.be && !accel->get_ssim()->Functional() ?
+                       accel->prefetcher.get() : nullptr;
+    int64_t cycle = accel->now() / accel->freq();
+    int64_t lead = -1;
+    if (prefetcher) {
+      lead = prefetcher->Demand(lrs->id(), *stream.ls, info.linebase, cycle);
+      if (lead != -1 && accel->in_roi()) {
+        ++accel->_stat_prefetch_useful;
+        accel->_stat_prefetch_lead_cycles += lead;
+      }
+    }
+    makeMemoryRequest(lrs, {}, ports, info, DMO_Read, /*prefetched*/lead != -1);
+    if (prefetcher) {
+      prefetchAhead(lrs, prefetcher, cycle);
+    }
+    int total_bytes = info.bytes_read();
     DSA_LOG(MEM_REQ)
       << "read request: " << info.linebase << ", " << info.start
       << " for " << stream.toString() << " in total " << total_bytes << " bytes";
@@ -696,23 +792,44 @@ struct StreamExecutor : dsa::sim::stream::Functor {
         DSA_LOG(DD) << "No resource to request!";
         return;
       }
-      uint64_t cacheline = accel->get_ssim()->spec.dma_bandwidth;
-      uint64_t linebase = 0;
-      for (int i = 0; ; ++i) {
-        if (irs->fsm.hasNext(accel) != 1) {
+      // Coalesce a window of elements, so that each distinct line is requested once.
+      // The lines are staged by the DMA controller until the last one arrives, which
+      // carries the map to scatter the elements back to the ports in order.
+      int64_t cacheline = accel->get_ssim()->spec.dma_bandwidth;
+      int width = irs->data_width();
+      std::vector<int64_t> lines;
+      std::vector<int> line_bytes;
+      std::vector<int> map;
+      SSMemReqInfo *last = nullptr;
+      // The window is bounded by the free buffer of the ports, which all the elements gathered
+      // are reserved in at once.
+      int space = bufferAvailable(irs->pes, std::numeric_limits<int>::max());
+      if (space < width) {
+        DSA_LOG(DD) << "No buffer to gather!";
+        return;
+      }
+      for (int i = 0; i < accel->get_ssim()->spec.dma_gather_window; ++i) {
+        if (irs->fsm.hasNext(accel) != 1 || (int) map.size() + width > space) {
           break;
         }
         auto buffer = irs->fsm.poll(accel, false, as);
-        if (i == 0) {
-          addrs.push_back(buffer[0]);
-          linebase = addrs[0] & ~(cacheline - 1);
-          irs->fsm.poll(accel, true, as);
-        } else if (buffer[0] > addrs.back() && buffer[0] < linebase + cacheline) {
-          addrs.push_back(buffer[0]);
-          irs->fsm.poll(accel, true, as);
-        } else {
-          break;
+        int64_t linebase = buffer[0] & ~(cacheline - 1);
+        DSA_CHECK(buffer[0] - linebase + width <= cacheline)
+          << buffer[0] << " straddles the line of " << cacheline << " bytes";
+        int k = std::find(lines.begin(), lines.end(), linebase) - lines.begin();
+        if (k == (int) lines.size()) {
+          if (!lines.empty() && canRequest(irs->src(), irs->pes[0].port, -1) == -1) {
+            break;
+          }
+          last = makeGatherRequest(irs->id(), irs->inst, ports, linebase);
+          lines.push_back(linebase);
+          line_bytes.push_back(0);
+        }
+        for (int j = 0; j < width; ++j) {
+          map.push_back(k * cacheline + buffer[0] - linebase + j);
         }
+        line_bytes[k] += width;
+        irs->fsm.poll(accel, true, as);
         // TODO(@were): Combine this with SPAD below
         if (irs->fsm.penetrate) {
           for (auto iport : ports) {
@@ -727,23 +844,27 @@ struct StreamExecutor : dsa::sim::stream::Functor {
           break;
         }
       }
-      std::vector<bool> bm(cacheline, false);
-      for (int j = 0; j < addrs.size(); ++j) {
-        auto addr = addrs[j];
-        for (int i = 0; i < irs->data_width(); ++i) {
-          DSA_CHECK(i + addr % cacheline < bm.size())
-            << i << " + " << addr % cacheline << " >= " << bm.size();
-          bm[i + addr - linebase] = true;
-        }
+      if (!last) {
+        DSA_LOG(DD) << "Nothing to gather!";
+        return;
       }
-      dsa::sim::stream::LinearStream::LineInfo info(linebase, addrs[0], bm, 0);
-      reserveBuffers(ports, irs->data_width() * addrs.size());
+      reserveBuffers(ports, map.size());
       // as.stream_last = !irs->fsm.hasNext(accel);
-      info.as = as;
-      info.as.padding = DP_NoPadding;
-      info.as.penetrate_state = state;
-      makeDMARequest(irs->id(), irs->inst, DMO_Read, ports, {}, info);
-      accel->statistics.countDataTraffic(true, irs->unit(), info.bytes_read());
+      last->as = as;
+      last->as.padding = DP_NoPadding;
+      last->as.penetrate_state = state;
+      last->map = std::move(map);
+      for (int k = 0; k < (int) lines.size(); ++k) {
+        accel->statistics.countDataTraffic(true, irs->unit(), line_bytes[k]);
+        if (auto *t = accel->tracer) {
+          t->Request(accel->now(), accel->accel_index(), irs->id(), ports[0], LOC::DMA,
+                     lines[k], line_bytes[k], true);
+        }
+      }
+      if (accel->in_roi()) {
+        accel->_stat_gather_elements += last->map.size() / width;
+        accel->_stat_gather_lines += lines.size();
+      }
     } else {
       // TODO(@were): How can I know which spad in advance?
       int spad_idx = -1;
@@ -756,7 +877,9 @@ struct StreamExecutor : dsa::sim::stream::Functor {
         }
       }
       auto &spad = accel->spads[spad_idx];
-      int n = spad.bandwidth() / irs->fsm.idx().dtype;
+      // The bank lines of all the elements are packed in one mask.
+      int n = std::min<int>(spad.bandwidth() / irs->fsm.idx().dtype,
+                            dsa::sim::ByteMask::MAX_BITS / spad.bank_width);
       for (int i = 0; i < n; ++i) {
         if (irs->fsm.hasNext(accel) != 1) {
           break;
@@ -782,15 +905,13 @@ struct StreamExecutor : dsa::sim::stream::Functor {
         DSA_CHECK(accel->whichSPAD(addr) == spad_idx);
         requests.emplace_back(irs->pes[0].port, addr, irs->dtype, MemoryOperation::DMO_Read);
         auto &mask = requests.back().mask;
-        mask.resize(spad.bank_width, 0);
+        mask = dsa::sim::ByteMask(spad.bank_width);
         int offset = addr % spad.bank_width;
         DSA_CHECK(offset % irs->dtype == 0) << addr << " is not aligned with " << irs->dtype;
-        for (int j = 0; j < irs->dtype; ++j) {
-          DSA_CHECK(offset + j < mask.size()) << "No bank straddle is allowed.";
-          mask[offset + j] = 1;
-        }
+        DSA_CHECK(offset + irs->dtype <= mask.size()) << "No bank straddle is allowed.";
+        mask.fill(offset, offset + irs->dtype);
         reserveBuffers(ports, irs->dtype);
-        meta.mask.insert(meta.mask.end(), mask.begin(), mask.end());
+        meta.mask.append(mask);
         DSA_LOG(MEM_REQ)
           << " [Indirect Read Request] addr: " << addr
           << ", memory op: " << MemoryOperation::DMO_Read;
@@ -799,6 +920,17 @@ struct StreamExecutor : dsa::sim::stream::Functor {
       meta.as = as;
       meta.as.penetrate_state = state;
       spad.rb->Decode(&spad, requests, meta);
+      if (auto *race = accel->race.get()) {
+        for (auto &elem : requests) {
+          race->Access(irs->id(), irs->barrier_mask(), spad_idx,
+                       elem.addr - elem.addr % spad.bank_width, elem.mask,
+                       dsa::sim::RaceDetector::Read);
+        }
+      }
+      if (auto *t = accel->tracer) {
+        t->Request(accel->now(), accel->accel_index(), irs->id(), ports[0], LOC::SCR,
+                   addrs.empty() ? 0 : addrs[0], addrs.size() * irs->dtype, true);
+      }
     }
   }
 
@@ -834,12 +966,10 @@ struct StreamExecutor : dsa::sim::stream::Functor {
     // TODO(@were): Unify this!
     if (ias->unit() == LOC::DMA) {
       uint64_t cacheline = accel->get_ssim()->spec.dma_bandwidth;
-      std::vector<bool> bm(cacheline, false);
+      dsa::sim::ByteMask bm(cacheline);
       auto addr = addrs[0];
       auto linebase = addr & ~(cacheline - 1);
-      for (int i = 0; i < ias->data_width(); ++i) {
-        bm[i + addr % cacheline] = true;
-      }
+      bm.fill(addr % cacheline, addr % cacheline + ias->data_width());
       dsa::sim::stream::LinearStream::LineInfo info(linebase, addr, bm, 0);
       // as.stream_last = !ias->fsm.hasNext(accel);
       info.as = as;
@@ -863,14 +993,12 @@ struct StreamExecutor : dsa::sim::stream::Functor {
         DSA_CHECK(accel->whichSPAD(addr) == spad_idx);
         requests.emplace_back(MEM_WR_STREAM, addr, ias->dtype, ias->mo);
         auto &mask = requests.back().mask;
-        mask.resize(spad.bank_width, 0);
+        mask = dsa::sim::ByteMask(spad.bank_width);
         int offset = addr % spad.bank_width;
         DSA_CHECK(offset % ias->dtype == 0) << addr << " is not aligned with " << ias->dtype;
-        for (int j = 0; j < ias->dtype; ++j) {
-          DSA_CHECK(offset + j < mask.size()) << "No bank straddle is allowed.";
-          mask[offset + j] = 1;
-        }
-        meta.mask.insert(meta.mask.end(), mask.begin(), mask.end());
+        DSA_CHECK(offset + ias->dtype <= mask.size()) << "No bank straddle is allowed.";
+        mask.fill(offset, offset + ias->dtype);
+        meta.mask.append(mask);
         requests.back().operand =
           std::vector<uint8_t>((uint8_t*)&data[i], (uint8_t*)&data[i] + ias->dtype);
         DSA_LOG(MEM_REQ)
@@ -886,6 +1014,16 @@ struct StreamExecutor : dsa::sim::stream::Functor {
       as.stream_last = !ias->fsm.hasNext(accel);
       meta.as = as;
       spad.rb->Decode(&spad, requests, meta);
+      if (auto *race = accel->race.get()) {
+        for (auto &elem : requests) {
+          race->Access(ias->id(), ias->barrier_mask(), spad_idx,
+                       elem.addr - elem.addr % spad.bank_width, elem.mask, raceKind(ias->mo));
+        }
+      }
+      if (auto *t = accel->tracer) {
+        t->Request(accel->now(), accel->accel_index(), ias->id(), MEM_WR_STREAM, LOC::SCR,
+                   addrs.empty() ? 0 : addrs[0], addrs.size() * ias->dtype, false);
+      }
     }
   }
 
@@ -934,7 +1072,7 @@ struct StreamExecutor : dsa::sim::stream::Functor {
     DSA_LOG(MEM_REQ) << "write bandwidth: " << memory_bw << ", port available: " << port_available;
     auto info = stream.ls->cacheline(memory_bw, std::min(memory_bw, port_available), stream.be,
                                      DMO_Write, stream.dest());
-    int to_pop = std::accumulate(info.mask.begin(), info.mask.end(), (int) 0, std::plus<int>());
+    int to_pop = info.bytes_read();
     int pop_pad = 0;
     if (info.as.dim_last) {
       if (stream.padding == DP_PostStridePredOff) {
@@ -1049,19 +1187,23 @@ struct SPADResponser : dsa::sim::stream::Functor {
   template<typename StreamT>
   void VisitImpl(StreamT *stream) {
     is_is = true;
-    std::vector<uint8_t> data;
-    data = apply_mask(response.raw.data(), response.info.mask);
     DSA_LOG(MEM_REQ)
       << "SPAD response stream " << stream->id() << ", "
       << "base: " << response.info.linebase << ", "
       << "start: " << response.info.start << ", "
-      << "data: " << data.size() << " bytes, "
+      << "data: " << response.info.bytes_read()
+      << " bytes, "
       << "shrink: " << response.info.shrink
       << (response.info.as.stream_last ? " last!" : "");
     DSA_LOG(MEM_REQ) << stream->toString();
     for (auto &elem : stream->pes) {
       auto &ivp = accel->input_ports[elem.port];
-      ivp.push(data, response.info.as, false);
+      ivp.pushMasked(response.raw.data(), response.info.mask, response.info.as, false);
+      if (auto *t = accel->tracer) {
+        int bytes = response.info.bytes_read();
+        t->Response(accel->now(), accel->accel_index(), stream->id(), elem.port, LOC::SCR,
+                    response.info.linebase, bytes);
+      }
       if (response.info.as.stream_last) {
         ivp.freeStream();
       }
@@ -1108,6 +1250,12 @@ struct SPADResponser : dsa::sim::stream::Functor {
 }
 
 void accel_t::tick() {
+  tickIssue();
+  cycle_cgra();
+  tickRetire();
+}
+
+void accel_t::tickIssue() {
   DSA_LOG(TICK) << curTick() << ": tick accelerator!";
   if (statistics.blame != dsa::stat::Accelerator::Blame::CONFIGURE) {
     statistics.blame = dsa::stat::Accelerator::Blame::UNKNOWN;
@@ -1162,9 +1310,9 @@ void accel_t::tick() {
   for (auto &elem : bsw.iports()) {
     input_ports[elem.port].tick();
   }
+}
 
-  cycle_cgra();
-
+void accel_t::tickRetire() {
   uint64_t cur_cycle = now();
 
   for (int i = 0; i < NUM_GROUPS; ++i) {
@@ -1194,6 +1342,112 @@ void accel_t::tick() {
   }
 
   statistics.blameCycle();
+
+  if (race) {
+    race->RetireBarriers([this] (int id, uint64_t mask) {
+      // The commands before the barrier still queued are not done either.
+      for (auto *cmd : _ssim->cmd_queue) {
+        if (cmd->id() < id && (cmd->context >> accel_index() & 1)) {
+          return false;
+        }
+      }
+      return done(false, mask);
+    });
+  }
+}
+
+bool accel_t::checkQuiescence() {
+  if (!get_ssim()->spec.idle_skip || !bsw.sched) {
+    return false;
+  }
+  if (statistics.blame == dsa::stat::Accelerator::Blame::CONFIGURE || _stream_cleanup_mode) {
+    return false;
+  }
+  if (!lsq()->is_pending_net_empty()) {
+    return false;
+  }
+  for (auto &elem : spads) {
+    if (elem.rb->Active()) {
+      return false;
+    }
+  }
+  for (auto &rec : bsw.orecords) {
+    if (!rec.port->raw.empty() || !rec.port->state.empty()) {
+      return false;
+    }
+  }
+  for (auto &rec : bsw.irecords) {
+    auto &ip = *rec.port;
+    if (!ip.buffer.empty()) {
+      return false;
+    }
+    // An active stream can only be blocked by the full DMA transfer queue,
+    // which is only drained by the responses.
+    if (ip.stream && ip.stream->stream_active()) {
+      if (ip.stream->unit() != LOC::DMA ||
+          lsq()->transferAvailable(ip.id())) {
+        return false;
+      }
+    }
+  }
+  for (auto &elem : bsw.dfg()->nodes) {
+    for (auto &value : elem->values) {
+      if (!value.fifo.empty()) {
+        return false;
+      }
+    }
+  }
+  return !shouldWakeUp();
+}
+
+bool accel_t::shouldWakeUp() {
+  if (lsq()->findResponse(CONFIG_STREAM) || !lsq()->is_pending_net_empty()) {
+    return true;
+  }
+  for (auto &rec : bsw.irecords) {
+    if (lsq()->findResponse(rec.port->id())) {
+      return true;
+    }
+    auto *stream = rec.port->stream;
+    if (stream && stream->stream_active() &&
+        lsq()->transferAvailable(rec.port->id())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void accel_t::skipCycle() {
+  DSA_CHECK(quiescent);
+  ++_skipped_cycles;
+  _last_skipped_cycle = now();
+}
+
+void accel_t::wakeUp() {
+  quiescent = false;
+  if (!_skipped_cycles) {
+    return;
+  }
+  DSA_LOG(TICK) << now() << ": wake up after " << _skipped_cycles << " skipped cycles";
+  // Everything below is what tick() accounts when nothing can happen.
+  arbiter->Skip(this, _skipped_cycles);
+  for (auto &elem : spads) {
+    elem.SkipIdle(_skipped_cycles);
+  }
+  _scr_ctrl_turn = (_scr_ctrl_turn + _skipped_cycles) % 2;
+  for (int i = 0; i < NUM_GROUPS; ++i) {
+    std::vector<bool> &prev_issued_group = _cgra_prev_issued_group[i];
+    int n = prev_issued_group.size();
+    for (int64_t j = 0; j < std::min<int64_t>(n, _skipped_cycles); ++j) {
+      prev_issued_group[(_last_skipped_cycle - j) % n] = false;
+    }
+  }
+  if (in_roi()) {
+    get_ssim()->update_stat_cycle(_last_skipped_cycle);
+  }
+  _waiting_cycles += _skipped_cycles;
+  statistics.blameSkippedCycles(_skipped_cycles);
+  _skipped_cycles = 0;
 }
 
 bool accel_t::is_shared() { return _accel_index == get_ssim()->lanes.size() - 1; }
@@ -1205,7 +1459,8 @@ bool accel_t::is_shared() { return _accel_index == get_ssim()->lanes.size() - 1;
 // 1. backpressure, or 2. temporal sharing.
 // Ports relevant for this simulation this are called "active_in_ports_bp"
 
-std::string dumpPredicatedValues(const std::vector<sim::PortPacket> &a) {
+template<typename T>
+std::string dumpPredicatedValues(const T &a) {
   ostringstream oss;
   for (int i = 0; i < (int) a.size(); ++i) {
     oss << " " << a[i].value << "(" << a[i].valid;
@@ -1217,55 +1472,50 @@ std::string dumpPredicatedValues(const std::vector<sim::PortPacket> &a) {
   return oss.str();
 }
 
+std::string dumpPredicatedValues(const std::vector<SBDT> &data, const std::vector<bool> &valid,
+                                 int from) {
+  std::vector<sim::PortPacket> a;
+  for (int j = from; j < (int) data.size() + from; ++j) {
+    a.emplace_back(sim::SpatialPacket(-1, data[j], valid[j]));
+  }
+  return dumpPredicatedValues(a);
+}
+
 void accel_t::cycle_cgra_backpressure() {
 
   int num_computed = 0;
 
-  auto ivps = bsw.sched->ssModel()->subModel()->input_list();
-  DSA_CHECK(ivps.size() > 0) << "No input ports!";
-  for (auto &elem : bsw.iports()) {
-    int port_index = elem.port;
-    auto &cur_in_port = input_ports[port_index];
-    
-    auto vp_iter = std::find_if(ivps.begin(), ivps.end(), [port_index] (ssivport *vp) {
-      return vp->port() == port_index;
-    });
-    DSA_CHECK(vp_iter != ivps.end()) << "Cannot find a mapping for input port "
-      << elem.port << " " << elem.vp->name();
-    ssivport *vp = *vp_iter;
-    auto *vec_in = dynamic_cast<dsa::dfg::InputPort*>(bsw.sched->dfgNodeOf(vp));
+  for (auto &rec : bsw.irecords) {
+    auto &cur_in_port = *rec.port;
+    auto *vec_in = rec.node;
 
     if (cur_in_port.lanesReady()) {
 
-      assert(vec_in != NULL && "input port pointer is null\n");
-
       if (vec_in->can_push()) {
         forward_progress();
         auto data = cur_in_port.poll();
-        DSA_CHECK(!data.empty()) << cur_in_port.vectorLanes();
+        DSA_CHECK(!data.empty()) << rec.lanes;
         bool valid = false;
-        std::vector<bool> predicates;
-        int stated = cur_in_port.ivp()->stated;
-        for (int i = 0; i < cur_in_port.vectorLanes(); ++i) {
-          vec_in->values[i + stated].push(data[i].value, data[i].valid, 0);
+        for (int i = 0; i < rec.lanes; ++i) {
+          vec_in->values[i + rec.stated].push(data[i].value, data[i].valid, 0);
           valid |= data[i].valid;
-          predicates.push_back(data[i].valid);
         }
-        if (stated) {
+        if (rec.stated) {
           uint8_t union_state = 0;
-          for (int i = 0; i < cur_in_port.vectorLanes(); ++i) {
+          for (int i = 0; i < rec.lanes; ++i) {
             union_state |= data[i].stream_state;
           }
-          cur_in_port.ivp()->values[0].push(union_state, valid, 0);
+          vec_in->values[0].push(union_state, valid, 0);
           DSA_LOG(COMP)
-            << "Push state " << cur_in_port.ivp()->name()
+            << "Push state " << vec_in->name()
             << ": " << std::bitset<8>(union_state).to_string();
         }
-        // TODO(@were): Move repeat port stuff to port pop.
-        cur_in_port.pop();
+        // The view follows the head of the buffer, so it is dumped before the pop.
         DSA_LOG(COMP)
           << now() << ": In Port: " << vec_in->name() << " allowed to push "
           << data.size() << " input(s): " << dumpPredicatedValues(data);
+        // TODO(@were): Move repeat port stuff to port pop.
+        cur_in_port.pop();
         DSA_LOG(COMP) << cur_in_port.pes.toString();
       } else {
         DSA_LOG(COMP) << vec_in->name() << " cannot push!";
@@ -1294,22 +1544,9 @@ void accel_t::cycle_cgra_backpressure() {
     _stat_ss_dfg_util += (double)num_computed / _dfg->instructions.size();
   }
 
-  auto ovps = bsw.sched->ssModel()->subModel()->output_list();
-  DSA_CHECK(ovps.size() > 0) << "No output ports!";
-  for (auto &elem : bsw.oports()) {
-    int port_index = elem.port; 
-    auto &cur_out_port = output_ports[port_index];
-
-    auto vp_iter = std::find_if(ovps.begin(), ovps.end(), [port_index] (ssovport *vp) {
-      return vp->port() == port_index;
-    });
-    DSA_CHECK(vp_iter != ovps.end()) << "Cannot find a mapping for output port "
-      << elem.port << " " << elem.vp->name();
-    ssovport* vp = *vp_iter;
-    auto *vec_output = dynamic_cast<dsa::dfg::OutputPort*>(bsw.sched->dfgNodeOf(vp));
-
-    DSA_CHECK(vec_output)
-      << vp->name() << ", " << vp->id() << " | " << elem.vp->name();
+  for (auto &rec : bsw.orecords) {
+    auto &cur_out_port = *rec.port;
+    auto *vec_output = rec.node;
 
     if (vec_output->can_pop()) {
       if (cur_out_port.bytesBuffered() > cur_out_port.vectorBytes()) {
@@ -1319,9 +1556,10 @@ void accel_t::cycle_cgra_backpressure() {
       if (!num_computed) {
         statistics.blame = dsa::stat::Accelerator::Blame::DRAIN_PIPE;
       }
-      vector<SBDT> data;
-      vector<bool> data_valid;
-      std::vector<sim::PortPacket> debug_data;
+      auto &data = _cgra_out_values;
+      auto &data_valid = _cgra_out_valid;
+      data.clear();
+      data_valid.clear();
       vec_output->pop(data, data_valid);
 
       forward_progress();
@@ -1330,15 +1568,12 @@ void accel_t::cycle_cgra_backpressure() {
         _stat_comp_instances += 1;
       }
 
-      int ops = cur_out_port.ovp()->penetrated_state;
-      int dtype = cur_out_port.scalarSizeInBytes();
+      int ops = rec.penetrated_state;
+      int dtype = rec.dtype;
       for (int j = ops != -1; j < (int) data.size() + (ops != -1); ++j) {
-        sim::SpatialPacket sp(-1, data[j], data_valid[j]);
-        debug_data.emplace_back(sp);
         // push the data to the CGRA output port only if discard is not 0
         if (data_valid[j]) {
-          std::vector<uint8_t> raw((uint8_t*)&data[j], (uint8_t*)&data[j] + dtype);
-          cur_out_port.push(raw);
+          cur_out_port.push(reinterpret_cast<const uint8_t*>(&data[j]), dtype);
         }
       }
       if (ops != -1) {
@@ -1347,7 +1582,7 @@ void accel_t::cycle_cgra_backpressure() {
       DSA_LOG(TICK) << curTick() << ": progress output";
       DSA_LOG(COMP)
         << now() << ": outvec[" << vec_output->name() << "] allowed to pop output: "
-        << dumpPredicatedValues(debug_data)
+        << dumpPredicatedValues(data, data_valid, ops != -1)
         << ", buffered " << cur_out_port.raw.size() << " byte(s)";
     }
   }
@@ -1658,6 +1893,9 @@ void accel_t::print_statistics(std::ostream &out) {
   // out << "BYTES READ AT PORT 5: " << _bytes_rd5 << "\n";
 
   out << "Commands Issued: " << statistics.commands_issued << "\n";
+  if (race) {
+    out << "Scratchpad Races: " << race->races << "\n";
+  }
   out << "CGRA Instances: " << _stat_comp_instances << " -- Activity Ratio: "
       << ((double)_stat_cgra_busy_cycles) / ((double)roi_cycles())
       << ", DFGs / Cycle: "
@@ -1757,15 +1995,78 @@ void accel_t::print_statistics(std::ostream &out) {
     << ", " << statistics.averageImpl(statistics.mem_lat_brkd[Minor::LSQ::LSQRequest::LSQRequestState::Translated])
     << ", " << statistics.averageImpl(statistics.mem_lat_brkd[Minor::LSQ::LSQRequest::LSQRequestState::RequestIssuing])
     << ", " << statistics.averageImpl(statistics.mem_lat_brkd[Minor::LSQ::LSQRequest::LSQRequestState::Complete]) << "\n";
+  auto print_latency = [&out](const std::string &name, const dsa::stat::Log2Histogram &h) {
+    out << name << ": " << h.count << " responses, " << h.mean() << " mean, "
+        << h.percentile(0.5) << " p50, " << h.percentile(0.9) << " p90, "
+        << h.percentile(0.99) << " p99, " << h.max << " max (cycles)\n";
+  };
+  print_latency("DMA Latency Distribution", statistics.latency_histo);
+  // The worst tails, which starve the CGRA the most.
+  for (auto &elem : statistics.worstStreams()) {
+    print_latency("  Stream " + std::to_string(elem.first), *elem.second);
+  }
+  {
+    std::vector<std::pair<int64_t, int>> ports;
+    for (auto &elem : statistics.port_latency) {
+      ports.emplace_back(-elem.second.percentile(0.99), elem.first);
+    }
+    std::sort(ports.begin(), ports.end());
+    for (int i = 0; i < (int) ports.size() && i < 8; ++i) {
+      print_latency("  Port " + std::to_string(ports[i].second),
+                    statistics.port_latency[ports[i].second]);
+    }
+  }
+  if (statistics.outstanding_reads.count) {
+    out << "Outstanding DMA Reads: " << statistics.outstanding_reads.mean() << " mean, "
+        << statistics.outstanding_reads.percentile(0.99) << " p99, "
+        << statistics.outstanding_reads.max << " max in "
+        << statistics.outstanding_reads.count << " samples\n";
+  }
+  auto print_service = [&out](const std::string &name, const dsa::stat::Accelerator::Service &s) {
+    out << name << ":";
+    for (int i = 0; i < dsa::stat::Accelerator::NUM_SERVICE_LEVELS; ++i) {
+      out << " " << dsa::stat::Accelerator::ServiceLevelStr[i] << "(" << s.requests[i] << ", "
+          << (double) s.latency[i] / std::max<int64_t>(s.requests[i], 1) << " c)";
+    }
+    out << " merged(" << s.merged << ")";
+    if (s.broken_down) {
+      out << " miss(" << (double) s.issue_delay / s.broken_down << " issue, "
+          << (double) s.forward_delay / s.broken_down << " forward, "
+          << (double) s.response_delay / s.broken_down << " response)";
+    }
+    out << "\n";
+  };
+  print_service("DMA Service", statistics.service[LOC::DMA]);
+  // The streams served the most reads.
+  for (auto &elem : statistics.busiestStreams()) {
+    print_service("  Stream " + std::to_string(elem.first), *elem.second);
+  }
   print_component("Write DMA", false, LOC::DMA);
   print_request("W/Request DMA", false, LOC::DMA, get_ssim()->spec.dma_bandwidth);
   out << "Bubbles Caused by TLB Transfer: " << statistics.memoryWriteBoundByXfer() << "\n";
+  out << "Indirect DMA Gather: " << _stat_gather_elements << " elements in "
+      << _stat_gather_lines << " line requests\n";
+  if (prefetcher) {
+    out << "Stream Prefetch: " << _stat_prefetch_issued << " issued, "
+        << _stat_prefetch_useful << " demanded (accuracy: "
+        << (double) _stat_prefetch_useful / std::max<uint64_t>(_stat_prefetch_issued, 1)
+        << "), " << (double) _stat_prefetch_lead_cycles / std::max<uint64_t>(_stat_prefetch_useful, 1)
+        << " cycles ahead, " << (double) _stat_prefetch_covered_latency / std::max<uint64_t>(_stat_prefetch_useful, 1)
+        << " cycles to respond the demands\n";
+  }
+  out << "Dispatch Blocked:";
+  for (int i = 0; i < dsa::stat::Accelerator::NUM_DISPATCH_BLOCKS; ++i) {
+    out << " " << dsa::stat::Accelerator::DispatchBlockStr[i] << "("
+        << statistics.dispatch_blocked[i] << ")";
+  }
+  out << "\n";
+  out << "Request Records: " << req_pool.allocated() << " allocated\n";
   print_component("Recur Bus", false, LOC::REC_BUS);
 
 }
 
 uint64_t accel_t::freq() {
-  return lsq()->get_cpu().clockDomain.clockPeriod();
+  return lsq()->clockPeriod();
 }
 
 // wait and print stats
@@ -1979,141 +2280,184 @@ bool scratch_write_controller_t::schedule_atomic_scr_op(
   return true;
 }
 
-void apply_map(uint8_t *raw_data, const vector<int> &imap,
-               std::vector<uint8_t> &data) {
-  assert(imap.size() != 0);
-  data.resize(imap.size());
-  for (int i = 0; i < imap.size(); ++i) {
-    // cout << "at imap[" << imap[i] << "], data=" << raw_data[imap[i]] << "\n";
-    data[i] = raw_data[imap[i]];
+/*!
+ * \brief Format the bytes of a DMA response for debugging.
+ */
+std::string dumpResponseBytes(const uint8_t *line, const SSMemReqInfo &info) {
+  std::ostringstream oss;
+  if (!info.mask.empty()) {
+    info.mask.forEach([&oss, line] (int i) { oss << " " << ((int) line[i]); });
+  } else {
+    for (int i = 0, n = info.map.size(); i < n; ++i) {
+      oss << " " << ((int) line[info.map[i]]);
+    }
   }
+  return oss.str();
 }
 
-void dma_controller_t::port_resp(sim::BitstreamWrapper::PortInfo &pi) {
+void dma_controller_t::port_resp(sim::BitstreamWrapper::PortInfo &pi, int &budget) {
   int cur_port = pi.port;
-  if (Minor::LSQ::LSQRequestPtr response =
-          _accel->lsq()->findResponse(cur_port)) {
+  auto &spec = get_ssim()->spec;
+  for (int k = 0; k < spec.dma_resp_per_port; ++k) {
+    const auto *response = _accel->lsq()->findResponse(cur_port);
+    if (!response) {
+      return;
+    }
 
     // First check if we haven't discared the memory request
     // this will only be the case if reqs are equal to zero
     if (_accel->_cleanup_mode) {
       _accel->lsq()->popResponse(cur_port);
       _mem_read_reqs--;
+      continue;
+    }
+
+    if (_accel->_accel_index != response->sdInfo->which_accel) {
       return;
     }
 
-    if (_accel->_accel_index == response->sdInfo->which_accel) {
+    DSA_CHECK(response->size == spec.dma_bandwidth)
+      << response->size << " " << spec.dma_bandwidth;
 
-      PacketPtr packet = response->packet;
-      DSA_CHECK(packet->getSize() == get_ssim()->spec.dma_bandwidth)
-        << packet->getSize() << " " << get_ssim()->spec.dma_bandwidth;
+    // The return bus is saturated in this cycle.
+    if (budget != -1 && budget < response->size) {
+      return;
+    }
 
-      vector<uint8_t> data;
-      if (response->sdInfo->mask.size() > 0) {
-        data = apply_mask(packet->getPtr<uint8_t>(), response->sdInfo->mask);
-      } else if (response->sdInfo->map.size() > 0) {
-        apply_map(packet->getPtr<uint8_t>(), response->sdInfo->map, data);
-      }
+    bool port_in_okay = true;
 
-      //-----------------
+    // push in byte-by-byte at the ports
+    for (int in_port : response->sdInfo->ports) {
+      auto &in_vp = _accel->input_ports[in_port];
+      port_in_okay = port_in_okay && in_vp.buffer.size() < in_vp.buffer_size;
+    }
 
-      bool port_in_okay = true;
+    if (!port_in_okay) {
+      return;
+    }
 
-      // push in byte-by-byte at the ports
-      for (int in_port : response->sdInfo->ports) {
-        auto &in_vp = _accel->input_ports[in_port];
-        port_in_okay = port_in_okay && in_vp.buffer.size() < in_vp.buffer_size;
+    const uint8_t *line = response->data;
+    const auto &info = *response->sdInfo;
+    _accel->statistics.countService(LOC::DMA, info.stream_id, response->service);
+    auto level = dsa::stat::Accelerator::serviceLevel(response->service);
+    if (info.gather) {
+      auto &stage = _gather_stage[cur_port];
+      stage.insert(stage.end(), line, line + response->size);
+      if (budget != -1) {
+        budget -= response->size;
       }
+      if (info.map.empty()) {
+        DSA_LOG(MEM_REQ) << "Gather line " << response->addr << " staged for port " << cur_port;
+        _accel->lsq()->popResponse(cur_port);
+        _mem_read_reqs--;
+        continue;
+      }
+      line = stage.data();
+    }
+    int bytes = 0;
+    if (!info.mask.empty()) {
+      bytes = info.mask.count();
+    } else {
+      bytes = info.map.size();
+    }
+    bool last = info.as.stream_last;
 
-      if (port_in_okay) {
-        bool last = response->sdInfo->as.stream_last;
-
-        std::ostringstream oss;
-        for (int i = 0, n = data.size(); i < n; ++i) {
-          oss << " " << ((int) data[i]);
-        }
-
-        DSA_LOG(MEM_REQ)
-          << get_ssim()->CurrentCycle() << " response for "
-          << std::hex << packet->getAddr() << std::dec
-          << "for port " << cur_port << ", size in bytes: "
-          << data.size() << " elements" << (last ? "(last)" : "") << oss.str();
-
-        // FIXME: check if stats are reset at roi
-        // _accel->_stat_mem_bytes_rd += data.size();
- 
-        // request for all added ports
-        for (int in_port : response->sdInfo->ports) {
-          auto &in_vp = _accel->input_ports[in_port];
-          if (auto *irs = dynamic_cast<IndirectReadStream*>(in_vp.stream)) {
-            if (irs->fsm.penetrate) {
-              auto *ip = dynamic_cast<dfg::InputPort*>(in_vp.vp);
-              DSA_CHECK(ip);
-              if (ip->stated) {
-                DSA_CHECK(!response->sdInfo->as.penetrate_state.empty()) << in_vp.vp->name();
-              }
-            }
-          }
-          in_vp.push(data, response->sdInfo->as, false);
-          if (last) {
-            DSA_LOG(STREAM) << in_vp.stream->toString() << " freed!";
-            if (auto irs = dynamic_cast<IndirectReadStream*>(in_vp.stream)) {
-              for (auto elem : irs->oports) {
-                auto &out_vp = _accel->output_ports[elem];
-                out_vp.freeStream();
-              }
-            }
-            in_vp.freeStream();
+    DSA_LOG(MEM_REQ)
+      << get_ssim()->CurrentCycle() << " response for "
+      << std::hex << response->addr << std::dec
+      << "for port " << cur_port << ", size in bytes: "
+      << bytes << " elements" << (last ? "(last)" : "") << dumpResponseBytes(line, info);
+
+    // FIXME: check if stats are reset at roi
+    // _accel->_stat_mem_bytes_rd += data.size();
+
+    // The latency is counted before the last response frees the stream and retires its
+    // distribution, otherwise the distribution misses it and is recreated never retired.
+    _accel->statistics.countMemoryLatency(info.request_cycle, response->sdInfo->breakdown,
+                                          info.stream_id, info.ports[0]);
+    if (info.prefetched && _accel->in_roi()) {
+      _accel->_stat_prefetch_covered_latency += (_accel->now() - info.request_cycle) / _accel->freq();
+    }
+
+    // request for all added ports
+    for (int in_port : info.ports) {
+      auto &in_vp = _accel->input_ports[in_port];
+      if (auto *irs = dynamic_cast<IndirectReadStream*>(in_vp.stream)) {
+        if (irs->fsm.penetrate) {
+          auto *ip = dynamic_cast<dfg::InputPort*>(in_vp.vp);
+          DSA_CHECK(ip);
+          if (ip->stated) {
+            DSA_CHECK(!info.as.penetrate_state.empty()) << in_vp.vp->name();
           }
-          DSA_LOG(MEM_REQ)
-            << pi.vp->name()
-            << " buffers " << in_vp.buffer.size() << " element(s)";
-        }
-
-
-        _accel->statistics.countMemoryLatency(response->sdInfo->request_cycle,
-                                              response->sdInfo->breakdown);
-
-        // cache hit stats collection
-        if(_accel->_ssim->in_roi()) {
-          _accel->_stat_tot_mem_wait_cycles += (_accel->get_cur_cycle()-response->sdInfo->request_cycle);
-          _accel->_stat_mem_bytes_rd += data.size();
-          if(_accel->get_cur_cycle()-response->sdInfo->request_cycle<20) { // probably L1 hit
-            // cout << "L1 hit\n";
-            _accel->_stat_hit_bytes_rd += data.size();
-          } else {
-            // cout << "L1 miss\n";
-            _accel->_stat_miss_bytes_rd += data.size();
-          } 
         }
-
-        if(_accel->_ssim->in_roi()) {
-          _accel->_stat_mem_bytes_rd += data.size();
+      }
+      if (!info.mask.empty()) {
+        in_vp.pushMasked(line, info.mask, info.as, false);
+      } else {
+        in_vp.pushMapped(line, info.map, info.as, false);
+      }
+      if (auto *t = _accel->tracer) {
+        t->Response(_accel->now(), _accel->accel_index(), info.stream_id, in_port, LOC::DMA,
+                    response->addr, bytes);
+      }
+      if (last) {
+        DSA_LOG(STREAM) << in_vp.stream->toString() << " freed!";
+        if (auto irs = dynamic_cast<IndirectReadStream*>(in_vp.stream)) {
+          for (auto elem : irs->oports) {
+            auto &out_vp = _accel->output_ports[elem];
+            out_vp.freeStream();
+          }
         }
-        data.clear();
-        _accel->lsq()->popResponse(cur_port);
-
-        _mem_read_reqs--;
-        return;
+        in_vp.freeStream();
+      }
+      DSA_LOG(MEM_REQ)
+        << pi.vp->name()
+        << " buffers " << in_vp.buffer.size() << " element(s)";
+    }
+
+
+    // cache hit stats collection
+    if(_accel->_ssim->in_roi()) {
+      _accel->_stat_tot_mem_wait_cycles += (_accel->get_cur_cycle()-info.request_cycle);
+      _accel->_stat_mem_bytes_rd += bytes;
+      // Out of Ruby, the level is not told, so it is guessed by the latency.
+      bool l1_hit = level == dsa::stat::Accelerator::UNKNOWN_LEVEL ?
+                    _accel->get_cur_cycle() - info.request_cycle < 20 :
+                    level == dsa::stat::Accelerator::L1;
+      if (l1_hit) {
+        // cout << "L1 hit\n";
+        _accel->_stat_hit_bytes_rd += bytes;
+      } else {
+        // cout << "L1 miss\n";
+        _accel->_stat_miss_bytes_rd += bytes;
       }
     }
+
+    if(_accel->_ssim->in_roi()) {
+      _accel->_stat_mem_bytes_rd += bytes;
+    }
+    if (info.gather) {
+      _gather_stage[cur_port].clear();
+    } else if (budget != -1) {
+      budget -= response->size;
+    }
+    _accel->lsq()->popResponse(cur_port);
+
+    _mem_read_reqs--;
   }
 }
 
 // ---------------------STREAM CONTROLLER TIMING
 // ------------------------------------ If response, can issue load Limitations:
-// 1 Response per cycle (512 bits/cycle)
+// dma_resp_per_port responses per port, and dma_return_bandwidth bytes per cycle
 void dma_controller_t::cycle() {
   // Memory read to config
-  if (Minor::LSQ::LSQRequestPtr response =
-          _accel->lsq()->findResponse(CONFIG_STREAM)) {
-    PacketPtr packet = response->packet;
+  if (const auto *response = _accel->lsq()->findResponse(CONFIG_STREAM)) {
     uint64_t context = response->sdInfo->which_accel;
     for (int i = 0; i < (int) _accel->get_ssim()->lanes.size(); ++i) {
       if (context >> i & 1) {
-        _accel->_ssim->lanes[i]->configure(packet->getAddr(),
-                                               packet->getSize() / 8,
-                                               packet->getPtr<uint64_t>());
+        _accel->_ssim->lanes[i]->configure(response->addr, response->size / 8,
+                                           (uint64_t*) response->data);
         _accel->statistics.blame = dsa::stat::Accelerator::UNKNOWN;
       }
     }
@@ -2121,9 +2465,16 @@ void dma_controller_t::cycle() {
   }
 
   // Memory Read to Ports
-  for (unsigned i = 0; i < _accel->bsw.iports().size(); ++i) {
-    auto &ref = _accel->bsw.iports()[i];
-    port_resp(ref);
+  // The ports take turns to be drained first, so that the later ones are not starved
+  // when the return bus is saturated.
+  int budget = get_ssim()->spec.dma_return_bandwidth;
+  auto &iports = _accel->bsw.iports();
+  for (unsigned i = 0; i < iports.size(); ++i) {
+    auto &ref = iports[(_which_resp + i) % iports.size()];
+    port_resp(ref, budget);
+  }
+  if (!iports.empty()) {
+    _which_resp = (_which_resp + 1) % iports.size();
   }
 
 }
@@ -2261,6 +2612,11 @@ void scratch_read_controller_t::serve_ind_read_banks() {
       // cout << "Identified a request at indirect scr bank which is remote? " << request.remote << endl;
 
       if(request.remote) {
+          // The bank holds the read until the network endpoint can queue its return.
+          if (!_accel->lsq()->can_push_net_req(request.bytes)) {
+            DSA_LOG(NET_REQ) << "Remote read return held at bank " << i << " by a full network queue";
+            continue;
+          }
           int8_t return_data[64]; // 8 byte*64 (uint64_t is 8 bytes)
           void * copy_addr = &return_data[0];
           // FIXME: stream id is incorrect, should we send it over network
@@ -2821,6 +3177,12 @@ bool accel_t::done(bool show, int mask) {
       }
     }
   }
+  if (mask == -1) {
+    // All the streams are freed, so their distributions should have been retired.
+    DSA_CHECK(statistics.stream_latency.empty() && statistics.stream_service.empty())
+      << statistics.stream_latency.size() << " latency and " << statistics.stream_service.size()
+      << " service entries of the streams are not retired when the lane drains!";
+  }
   return true;
 }
 
@@ -2967,27 +3329,143 @@ void accel_t::configure(addr_t addr, int size, uint64_t *bits) {
     << "dsaURE(response): " << "0x" << std::hex
     << addr << " " << std::dec << size;
 
-  std::string basename = ((char*)(bits) + 9);
-  dsa::dfg::Import(".sched/" + basename + ".dfg.json");
-  dfg = dsa::dfg::Import(".sched/" + basename + ".dfg.json");
+  loadConfig((char*)(bits) + 9);
+}
+
+void accel_t::loadConfig(const std::string &basename) {
+  config_name = basename;
+  // The parsed graph is shared by all the lanes and cores, but each lane
+  // simulates its own copy, checked to share no node, because the graph carries
+  // the simulation state. The schedule points into that copy, so it is loaded
+  // again for each lane.
+  auto cached = dsa::sim::BitstreamCache::Get(basename);
+  dsa::sim::BitstreamCache::Instantiate(*cached, dfg);
   sched = Schedule(_ssconfig, &dfg);
   sched.LoadMappingInJson(".sched/" + basename + ".sched.json");
   bsw = dsa::sim::BitstreamWrapper(&sched);
-
-  for (auto &elem : bsw.iports()) {
-    DSA_CHECK(elem.port >= 0 && elem.port < input_ports.size());
-    auto &vp = input_ports[elem.port];
-    vp.vp = elem.vp;
+  bsw.BindPorts(input_ports, output_ports);
+}
+
+/*!
+ * \brief The counters of the lane which the report and the gem5 statistics read, so that they
+ *        are checkpointed along with the statistics and do not restart from zero on restore.
+ */
+#define LANE_COUNTERS(F)                                                                  \
+  F(_stat_comp_instances); F(_stat_cgra_busy_cycles);                                     \
+  F(_stat_scratch_read_bytes); F(_stat_scratch_write_bytes);                              \
+  F(_stat_scratch_reads); F(_stat_scratch_writes);                                        \
+  F(_stat_cycles_atomic_scr_pushed); F(_stat_cycles_atomic_scr_executed);                 \
+  F(_stat_mem_bytes_rd); F(_stat_tot_mem_wait_cycles);                                    \
+  F(_stat_hit_bytes_rd); F(_stat_miss_bytes_rd);                                          \
+  F(_stat_gather_elements); F(_stat_gather_lines);                                        \
+  F(_stat_prefetch_issued); F(_stat_prefetch_useful);                                     \
+  F(_stat_prefetch_covered_latency); F(_stat_prefetch_lead_cycles);                       \
+  F(_stat_conflict_cycles); F(_stat_tot_atom_cycles); F(_stat_port_imbalance)
+
+namespace {
+
+/*! \brief Flatten the histogram of stream volumes, for the checkpoint. */
+std::vector<uint64_t> flattenHisto(const stream_stats_histo_t &histo) {
+  std::vector<uint64_t> res(histo.vol_by_type, histo.vol_by_type + (int) STR_PAT::LEN);
+  res.insert(res.end(), histo.vol_by_len, histo.vol_by_len + 64);
+  res.push_back(histo.total_vol);
+  res.push_back(histo.total);
+  res.push_back(histo.vol_by_source.size());
+  for (auto &elem : histo.vol_by_source) {
+    res.insert(res.end(), {(uint64_t) elem.first.first, (uint64_t) elem.first.second, elem.second});
+  }
+  for (auto &elem : histo.vol_by_len_map) {
+    res.insert(res.end(), {elem.first, elem.second});
   }
+  return res;
+}
 
-  for (auto &elem : bsw.oports()) {
-    DSA_CHECK(elem.port >= 0 && elem.port < output_ports.size());
-    auto &vp = output_ports[elem.port];
-    vp.vp = elem.vp;
+void restoreHisto(stream_stats_histo_t &histo, const std::vector<uint64_t> &flat) {
+  int fixed = (int) STR_PAT::LEN + 64 + 3;
+  DSA_CHECK((int) flat.size() >= fixed) << "The stream statistics differ from the checkpoint!";
+  auto iter = flat.begin();
+  std::copy(iter, iter + (int) STR_PAT::LEN, histo.vol_by_type);
+  iter += (int) STR_PAT::LEN;
+  std::copy(iter, iter + 64, histo.vol_by_len);
+  iter += 64;
+  histo.total_vol = *iter++;
+  histo.total = *iter++;
+  int64_t sources = *iter++;
+  int64_t rest = flat.end() - iter;
+  DSA_CHECK(rest >= sources * 3 && (rest - sources * 3) % 2 == 0)
+    << "The stream statistics differ from the checkpoint!";
+  histo.vol_by_source.clear();
+  for (int64_t i = 0; i < sources; ++i, iter += 3) {
+    histo.vol_by_source[std::make_pair((int) iter[0], (int) iter[1])] = iter[2];
+  }
+  histo.vol_by_len_map.clear();
+  for (; iter != flat.end(); iter += 2) {
+    histo.vol_by_len_map[iter[0]] = iter[1];
   }
+}
 
 }
 
+void accel_t::serialize(CheckpointOut &cp) const {
+  for (auto &spad : spads) {
+    DSA_CHECK(!spad.rb->Active()) << "Scratchpad requests in flight cannot be checkpointed!";
+  }
+  SERIALIZE_SCALAR(config_name);
+  for (int i = 0; i < (int) spads.size(); ++i) {
+    for (int j = 0; j < (int) spads[i].banks.size(); ++j) {
+      arrayParamOut(cp, csprintf("spad%d.bank%d", i, j), spads[i].banks[j].data);
+    }
+  }
+  SERIALIZE_CONTAINER(scratchpad);
+  statistics.serialize(cp);
+  LANE_COUNTERS(SERIALIZE_SCALAR);
+  arrayParamOut(cp, "pipe_stats", _pipe_stats.pipe_stats, pipeline_stats_t::LAST);
+  arrayParamOut(cp, "stream_reqs", flattenHisto(_stream_stats.reqs_histo));
+  arrayParamOut(cp, "stream_vol", flattenHisto(_stream_stats.vol_histo));
+  std::vector<uint64_t> bw;
+  for (auto &elem : _bw_map) {
+    bw.insert(bw.end(), {(uint64_t) elem.first.first, (uint64_t) elem.first.second,
+                         elem.second.first, elem.second.second});
+  }
+  SERIALIZE_CONTAINER(bw);
+}
+
+void accel_t::unserialize(CheckpointIn &cp) {
+  std::string name;
+  paramIn(cp, "config_name", name);
+  if (!name.empty()) {
+    loadConfig(name);
+  }
+  for (int i = 0; i < (int) spads.size(); ++i) {
+    for (int j = 0; j < (int) spads[i].banks.size(); ++j) {
+      auto &data = spads[i].banks[j].data;
+      auto size = data.size();
+      arrayParamIn(cp, csprintf("spad%d.bank%d", i, j), data);
+      DSA_CHECK(data.size() == size)
+        << "The scratchpad geometry differs from the checkpoint: " << data.size() << " bytes "
+        << "in spad" << i << ".bank" << j << ", expected " << size;
+    }
+  }
+  UNSERIALIZE_CONTAINER(scratchpad);
+  statistics.unserialize(cp);
+  LANE_COUNTERS(UNSERIALIZE_SCALAR);
+  arrayParamIn(cp, "pipe_stats", _pipe_stats.pipe_stats, pipeline_stats_t::LAST);
+  std::vector<uint64_t> histo;
+  arrayParamIn(cp, "stream_reqs", histo);
+  restoreHisto(_stream_stats.reqs_histo, histo);
+  arrayParamIn(cp, "stream_vol", histo);
+  restoreHisto(_stream_stats.vol_histo, histo);
+  std::vector<uint64_t> bw;
+  UNSERIALIZE_CONTAINER(bw);
+  DSA_CHECK(bw.size() % 4 == 0) << "The traffic statistics differ from the checkpoint!";
+  _bw_map.clear();
+  for (int i = 0; i < (int) bw.size(); i += 4) {
+    _bw_map[std::make_pair((LOC) bw[i], (LOC) bw[i + 1])] = std::make_pair(bw[i + 2], bw[i + 3]);
+  }
+}
+
+#undef LANE_COUNTERS
+
 void scratch_write_controller_t::insert_pending_request_queue(int tid, vector<int> start_addr, int bytes_waiting) {
   if(start_addr.size()==0) return; // for current bad impl
   auto it = _pending_request_queue.find(tid);
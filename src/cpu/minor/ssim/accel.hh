@@ -35,7 +35,12 @@
 #include "./consts.hh"
 #include "./statistics.h"
 #include "./spad.h"
+#include "./req_pool.h"
+#include "./prefetch.h"
+#include "./race.h"
+#include "./trace.h"
 #include "sim/port.hh"
+#include "sim/serialize.hh"
 
 namespace dsa {
 namespace sim {
@@ -109,6 +114,7 @@ class dma_controller_t : public data_controller_t {
   void reset_stream_engines() {
     _read_streams.clear();
     _write_streams.clear();
+    _gather_stage.clear();
   }
 
   void reset_data() {
@@ -129,6 +135,8 @@ class dma_controller_t : public data_controller_t {
   void print_status();
   void cycle_status();
 
+  uint64_t mem_read_reqs() const {return _mem_read_reqs;}
+  uint64_t mem_write_reqs() const {return _mem_write_reqs;}
   bool mem_reads_outstanding()  {return _mem_read_reqs;}
   bool mem_writes_outstanding() {return _mem_write_reqs;}
   bool scr_reqs_outstanding()  {return _fake_scratch_reqs;}
@@ -153,9 +161,21 @@ class dma_controller_t : public data_controller_t {
   scratch_write_controller_t* _scr_w_c;
   network_controller_t* _net_c;
 
-  void port_resp(sim::BitstreamWrapper::PortInfo &pi);
+  /*!
+   * \brief Drain the DMA responses of the given port.
+   * \param pi The port to drain.
+   * \param budget The bytes the return bus can still deliver in this cycle, -1 if unbounded.
+   */
+  void port_resp(sim::BitstreamWrapper::PortInfo &pi, int &budget);
+
+  /*!
+   * \brief The lines of the indirect gather in flight of each port, in the order requested.
+   */
+  std::unordered_map<int, std::vector<uint8_t>> _gather_stage;
 
   unsigned _which_rd=0, _which_wr=0;
+  /*! \brief The input port drained first in this cycle. */
+  unsigned _which_resp=0;
 
   std::vector<base_stream_t*> _read_streams;
   std::vector<base_stream_t*> _write_streams;
@@ -630,7 +650,7 @@ struct pipeline_stats_t {
 
 };
 
-class accel_t {
+class accel_t : public Serializable {
   friend class ssim_t;
   friend class scratch_read_controller_t;
   friend class scratch_write_controller_t;
@@ -643,6 +663,23 @@ public:
    * \brief The stream scheduler.
    */
   sim::StreamArbiter *arbiter{nullptr};
+  /*!
+   * \brief The binary trace of stream lifetimes, nullptr if tracing is off.
+   */
+  sim::TraceSink *tracer{nullptr};
+  /*!
+   * \brief The checker of the scratchpad accesses, nullptr if $DSA_SPEC does not enable race_check.
+   */
+  std::unique_ptr<sim::RaceDetector> race;
+  /*!
+   * \brief The lookahead of the affine DMA read streams, nullptr if dma_prefetch_distance is 0.
+   */
+  std::unique_ptr<sim::StreamPrefetcher> prefetcher;
+
+  /*!
+   * \brief The records of the memory requests of this lane.
+   */
+  sim::ReqInfoPool req_pool;
 
   /*!
    * \brief The statistics of the accelerator.
@@ -653,6 +690,10 @@ public:
    * \brief The information of soft configuration.
    */
   dsa::sim::BitstreamWrapper bsw;
+  /*!
+   * \brief The basename of the DFG configured, empty if the lane is not configured yet.
+   */
+  std::string config_name;
 
   // {
   SSDfg dfg;
@@ -669,6 +710,12 @@ public:
    */
   std::vector<dsa::sim::OutPort> output_ports;
 
+  /*!
+   * \brief The ports whose streams are freed since the last dispatch, [0] output, [1] input.
+   *        Written by the lane alone, so that the lanes can be ticked in parallel.
+   */
+  std::vector<int> freed_ports[2];
+
   /*!
    * \brief Get the corresponding port.
    * \param isInput If it is an input port.
@@ -694,7 +741,7 @@ public:
 
 
   accel_t(int i, ssim_t* ssim);
-  Minor::LSQ *lsq();
+  dsa::sim::MemoryInterface *lsq();
 
   bool in_use();
   void timestamp(); //print timestamp
@@ -724,11 +771,58 @@ public:
   }
 
   void configure(addr_t addr, int size, uint64_t* bits);
+  /*!
+   * \brief Load the DFG of the given basename and its schedule to the lane.
+   */
+  void loadConfig(const std::string &basename);
+
+  /*!
+   * \brief Checkpoint the configuration, the scratchpads, and the statistics.
+   *        The streams in flight are not checkpointed, so the lane should be drained first.
+   */
+  void serialize(CheckpointOut &cp) const override;
+  void unserialize(CheckpointIn &cp) override;
 
   pipeline_stats_t::PIPE_STATUS whos_to_blame(int group);
   void whos_to_blame(std::vector<pipeline_stats_t::PIPE_STATUS>& blame_vec,
                      std::vector<pipeline_stats_t::PIPE_STATUS>& group_vec);
   void tick(); //Tick one time
+  /*!
+   * \brief The first part of tick(): issue the streams, and step the memories and
+   *        the controllers. This part talks to the LSQ and the other lanes.
+   */
+  void tickIssue();
+  /*!
+   * \brief The last part of tick(): account the statistics, and retire the cycle.
+   *        Between tickIssue() and tickRetire(), cycle_cgra() only touches this lane.
+   */
+  void tickRetire();
+
+  /*!
+   * \brief If nothing on this lane can happen until a DMA response comes back,
+   *        or the host issues new commands. Quiescent lanes are not ticked.
+   */
+  bool quiescent{false};
+
+  /*!
+   * \brief Check if this lane can stop ticking after this cycle.
+   */
+  bool checkQuiescence();
+
+  /*!
+   * \brief If any event a quiescent lane is waiting for has happened.
+   */
+  bool shouldWakeUp();
+
+  /*!
+   * \brief Skip the tick of this cycle, because this lane is quiescent.
+   */
+  void skipCycle();
+
+  /*!
+   * \brief Resume ticking, and credit the statistics of the skipped cycles.
+   */
+  void wakeUp();
 
   uint64_t roi_cycles();
 
@@ -768,12 +862,22 @@ public:
   scratch_read_controller_t*  scr_r_c() {return &_scr_r_c;}
   scratch_write_controller_t* scr_w_c() {return &_scr_w_c;}
   network_controller_t* net_c() {return &_net_c;}
+  dma_controller_t* dma_c() {return &_dma_c;}
 
 private:
   ssim_t* _ssim;
   bool _cleanup_mode=false;
   bool _stream_cleanup_mode=false;
 
+  /*!
+   * \brief The cycles skipped whose statistics are not credited yet.
+   */
+  int64_t _skipped_cycles{0};
+  /*!
+   * \brief The last cycle skipped.
+   */
+  uint64_t _last_skipped_cycle{0};
+
   //***timing-related code***
   bool done_internal(bool show, int mask);
   bool done_concurrent(bool show, int mask);
@@ -810,42 +914,12 @@ private:
     }
 
     std::memcpy(dest, &scratchpad[scr_addr], count);
-    // TODO: change this for linear spad case
-    for(int i = 0; i < count; i+=sizeof(SBDT)) {
-      uint64_t running_addr=  scr_addr+i;
-      if(scratchpad_writers[running_addr]) {
-        DSA_LOG(CHECK_SCR_ALIAS)
-          << "WARNING: scr_addr: " << running_addr
-          << " constistency is potentially violated; "
-          << " writer_id: " << scratchpad_writers[running_addr]
-          << " reader_id: " << id;
-      }
-      scratchpad_readers[running_addr]=id;
-    }
   }
 
   void write_scratchpad(uint64_t scr_addr, const void* src,
       std::size_t count, int id) {
     // std::cout << "NEW SCRATCHPAD SIZE: " << scratchpad.size() << "\n";
     std::memcpy(&scratchpad[scr_addr], src, count);
-    for(int i = 0; i < count; i+=sizeof(SBDT)) {
-      uint64_t running_addr = scr_addr+i;
-      if(scratchpad_writers[running_addr]) {
-        DSA_LOG(CHECK_SCR_ALIAS)
-          << "WARNING: scr_addr: " << running_addr
-          << " constistency is potentially violated; "
-          << " writer_id: " << scratchpad_writers[running_addr]
-          << " writer_id: " << id;
-      }
-      if(scratchpad_readers[running_addr]) {
-        DSA_LOG(CHECK_SCR_ALIAS)
-          << "WARNING: scr_addr: " << running_addr
-          << " constistency is potentially violated; "
-          << " reader_id: " << scratchpad_readers[running_addr]
-          << " writer_id: " << id;
-      }
-      scratchpad_writers[running_addr]=id;
-    }
   }
 
   void receive_message(int8_t* data, int num_bytes, int remote_in_port) {
@@ -935,6 +1009,9 @@ private:
   int _scr_ctrl_turn = 0;
 
   std::vector<bool> _cgra_prev_issued_group[NUM_GROUPS];
+  // Reused across cycles to pop the outputs of the CGRA without allocation.
+  std::vector<SBDT> _cgra_out_values;
+  std::vector<bool> _cgra_out_valid;
   //uint64_t _delay_group_until[NUM_GROUPS]={0,0,0,0,0,0};
 
   //* Stats
@@ -979,6 +1056,12 @@ private:
   int _stat_hit_bytes_rd=0;
   int _stat_miss_bytes_rd=0;
   int _stat_num_spu_req_coalesced=0;
+  uint64_t _stat_gather_elements=0;
+  uint64_t _stat_gather_lines=0;
+  uint64_t _stat_prefetch_issued=0;
+  uint64_t _stat_prefetch_useful=0;
+  uint64_t _stat_prefetch_covered_latency=0;
+  uint64_t _stat_prefetch_lead_cycles=0;
   int _stat_conflict_cycles=0;
   int _stat_tot_atom_cycles=0;
   // for backcgra
@@ -1011,8 +1094,4 @@ private:
 
   std::map<std::pair<LOC,LOC>, std::pair<uint64_t,uint64_t>> _bw_map;
 
-  //Checking data structures
-  std::vector<int> scratchpad_writers;
-  std::vector<int> scratchpad_readers;
-
 };
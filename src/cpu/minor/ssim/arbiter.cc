@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstdlib>
+
 #include "stream.hh"
 #include "arbiter.h"
 #include "accel.hh"
@@ -46,46 +49,133 @@ struct BuffetChecker : dsa::sim::stream::Functor {
     bool ok{true};
 };
 
-std::vector<base_stream_t*> RoundRobin::Arbit(accel_t *accel) {
-  BitstreamWrapper &bsw = accel->bsw;
-  std::vector<std::vector<base_stream_t*>> stream_tables;
-  stream_tables.resize(LOC::TOTAL * 2);
-  for (int is_input = 0; is_input < 2; ++is_input) {
-    const auto &ports = bsw.ports[is_input];
-    for (int i = 0; i < (int) ports.size(); ++i) {
-      if (auto *stream = accel->port(is_input, ports[i].port)->stream) {
-        if (stream->stream_active()) {
-          BuffetChecker bc;
-          stream->Accept(&bc);
-          if (bc.ok) {
-            bool allow_rw = (bool) getenv("RW_BUS");
-            int key = 0;
-            if (allow_rw) {
-              key = is_input * LOC::TOTAL + stream->side(is_input);
-            } else {
-              key = (stream->side(is_input) != LOC::DMA) * is_input * LOC::TOTAL + stream->side(is_input);
-            }
-            stream_tables[key].push_back(stream);
-          }
+StreamArbiter::StreamArbiter() : allow_rw((bool) getenv("RW_BUS")), stream_tables(LOC::TOTAL * 2) {}
+
+void StreamArbiter::Bind(Port *port, bool is_input) {
+  auto key = std::make_pair(is_input, port);
+  auto iter = std::lower_bound(active.begin(), active.end(), key,
+    [](const std::pair<bool, Port*> &a, const std::pair<bool, Port*> &b) {
+      return a.first != b.first ? a.first < b.first : a.second->id() < b.second->id();
+    });
+  DSA_CHECK(iter == active.end() || iter->second != port) << "Port " << port->id() << " bound twice!";
+  active.insert(iter, key);
+}
+
+void StreamArbiter::Free(Port *port, bool is_input) {
+  auto iter = std::find(active.begin(), active.end(), std::make_pair(is_input, port));
+  DSA_CHECK(iter != active.end()) << "Port " << port->id() << " is not bound!";
+  active.erase(iter);
+}
+
+std::vector<std::vector<StreamArbiter::Candidate>> &StreamArbiter::StreamTables(accel_t *accel) {
+  for (auto &table : stream_tables) {
+    table.clear();
+  }
+  for (auto &elem : active) {
+    bool is_input = elem.first;
+    auto *stream = elem.second->stream;
+    if (stream->stream_active()) {
+      BuffetChecker bc;
+      stream->Accept(&bc);
+      if (bc.ok) {
+        int key = 0;
+        if (allow_rw) {
+          key = is_input * LOC::TOTAL + stream->side(is_input);
+        } else {
+          key = (stream->side(is_input) != LOC::DMA) * is_input * LOC::TOTAL + stream->side(is_input);
         }
+        stream_tables[key].emplace_back(stream, elem.second, is_input);
       }
     }
   }
+  return stream_tables;
+}
+
+std::vector<base_stream_t*> StreamArbiter::Arbit(accel_t *accel) {
+  auto &tables = StreamTables(accel);
   std::vector<base_stream_t*> res;
-  for (int i = 0; i < stream_tables.size(); ++i) {
-    if (!stream_tables[i].empty()) {
-      res.push_back(stream_tables[i][last_executed[i] % stream_tables[i].size()]);
-      last_executed[i]++;
+  for (int i = 0; i < (int) tables.size(); ++i) {
+    if (!tables[i].empty()) {
+      int picked = Pick(i, tables[i]);
+      DSA_CHECK(picked >= 0 && picked < (int) tables[i].size()) << "Invalid pick " << picked;
+      auto *stream = tables[i][picked].stream;
+      // A stream with both sides on the same unit may be picked by two tables.
+      if (std::find(res.begin(), res.end(), stream) == res.end()) {
+        res.push_back(stream);
+      }
     }
   }
-  std::sort(res.begin(), res.end());
-  auto new_end = std::unique(res.begin(), res.end());
-  res.resize(new_end - res.begin());
   for (auto elem : res) {
     DSA_LOG(STREAM_SCHEDULE) << accel->now() << ": " << elem->toString();
   }
   return res;
 }
 
+StreamArbiter *StreamArbiter::Create(const std::string &policy) {
+  if (policy == "round-robin") {
+    return new RoundRobin();
+  }
+  if (policy == "oldest-first") {
+    return new OldestFirst();
+  }
+  if (policy == "starvation") {
+    return new Starvation();
+  }
+  DSA_CHECK(false) << "Unknown stream arbiter: " << policy
+                   << ", expected round-robin, oldest-first, or starvation";
+  return nullptr;
+}
+
+int RoundRobin::Pick(int table, const std::vector<Candidate> &cands) {
+  return last_executed[table]++ % cands.size();
+}
+
+void RoundRobin::Skip(accel_t *accel, int64_t cycles) {
+  auto &tables = StreamTables(accel);
+  for (int i = 0; i < (int) tables.size(); ++i) {
+    if (!tables[i].empty()) {
+      last_executed[i] += cycles;
+    }
+  }
+}
+
+int OldestFirst::Pick(int table, const std::vector<Candidate> &cands) {
+  int res = 0;
+  for (int i = 1; i < (int) cands.size(); ++i) {
+    if (cands[i].stream->id() < cands[res].stream->id()) {
+      res = i;
+    }
+  }
+  return res;
+}
+
+double Starvation::Slack(const Candidate &cand) {
+  // Ports not mapped by the DFG only buffer for other streams, e.g. indirect indices,
+  // which the CGRA waits for as well.
+  if (!cand.port->vp) {
+    return 0;
+  }
+  double vec = std::max(cand.port->vectorBytes(), 1);
+  if (cand.is_input) {
+    auto *ip = static_cast<InPort*>(cand.port);
+    return (ip->bytesBuffered() + ip->ongoing) / vec;
+  }
+  // The output port stalls the CGRA when it cannot hold two more vectors.
+  return (2 * vec - cand.port->bytesBuffered()) / vec;
+}
+
+int Starvation::Pick(int table, const std::vector<Candidate> &cands) {
+  int res = 0;
+  double best = Slack(cands[0]);
+  for (int i = 1; i < (int) cands.size(); ++i) {
+    double slack = Slack(cands[i]);
+    if (slack < best || (slack == best && cands[i].stream->id() < cands[res].stream->id())) {
+      res = i;
+      best = slack;
+    }
+  }
+  return res;
+}
+
 }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "stream.hh"
@@ -14,14 +16,79 @@ struct BitstreamWrapper;
 
 /*!
  * \brief The base class of determining which streams to be executed.
+ *        Each cycle, the executable streams are grouped by the memory unit they occupy,
+ *        and one stream is picked from each group by the arbitration policy.
  */
 struct StreamArbiter {
+  /*!
+   * \brief An executable stream, and the port through which it is found.
+   */
+  struct Candidate {
+    base_stream_t *stream;
+    Port *port;
+    bool is_input;
+
+    Candidate(base_stream_t *s, Port *p, bool i) : stream(s), port(p), is_input(i) {}
+  };
+
+  StreamArbiter();
+
+  virtual ~StreamArbiter() {}
+
   /*!
    * \brief Determine the streams to be executed according to the state of each port.
    */
-  virtual std::vector<base_stream_t*> Arbit(accel_t *accel) = 0;
+  std::vector<base_stream_t*> Arbit(accel_t *accel);
+  /*!
+   * \brief Forward the arbitration state over the cycles skipped when the accelerator
+   *        is quiescent, as if Arbit was called for each of them.
+   * \param cycles The number of cycles skipped.
+   */
+  virtual void Skip(accel_t *accel, int64_t cycles) {}
+  /*!
+   * \brief Pick a stream to execute from a group.
+   * \param table The index of the group.
+   * \param cands The executable streams of the group, which is never empty.
+   * \return The index of the picked candidate.
+   */
+  virtual int Pick(int table, const std::vector<Candidate> &cands) = 0;
+  /*!
+   * \brief Register the port to be bound with a stream.
+   */
+  void Bind(Port *port, bool is_input);
+  /*!
+   * \brief Deregister the port whose stream is freed.
+   */
+  void Free(Port *port, bool is_input);
+  /*!
+   * \brief Create an arbiter by the name of the policy.
+   * \param policy "round-robin", "oldest-first", or "starvation".
+   */
+  static StreamArbiter *Create(const std::string &policy);
+
+ protected:
+  /*!
+   * \brief Group the executable streams by the memory units they occupy.
+   */
+  std::vector<std::vector<Candidate>> &StreamTables(accel_t *accel);
+  /*!
+   * \brief If reads and writes from the DMA are arbitrated separately.
+   */
+  bool allow_rw;
+  /*!
+   * \brief The ports bound with a stream, in the order of (is_input, port id).
+   *        Maintained when streams are bound and freed, so that idle ports are never scanned.
+   */
+  std::vector<std::pair<bool, Port*>> active;
+  /*!
+   * \brief The streams grouped by the memory units, reused across cycles.
+   */
+  std::vector<std::vector<Candidate>> stream_tables;
 };
 
+/*!
+ * \brief Execute the streams of each group in turn.
+ */
 struct RoundRobin : StreamArbiter {
   /*!
    * \brief The last executed streams of round robin.
@@ -30,7 +97,31 @@ struct RoundRobin : StreamArbiter {
 
   RoundRobin() : last_executed(std::vector<int>(LOC::TOTAL * 2, 0)) {}
 
-  std::vector<base_stream_t*> Arbit(accel_t *accel) override;
+  int Pick(int table, const std::vector<Candidate> &cands) override;
+
+  void Skip(accel_t *accel, int64_t cycles) override;
+};
+
+/*!
+ * \brief Execute the stream issued earliest by the host in each group.
+ */
+struct OldestFirst : StreamArbiter {
+  int Pick(int table, const std::vector<Candidate> &cands) override;
+};
+
+/*!
+ * \brief Execute the stream whose port is closest to stalling the CGRA in each group:
+ *        the input port with the fewest vectors buffered or ongoing,
+ *        or the output port with the least space before backpressure.
+ *        Ties are broken by the age of streams.
+ */
+struct Starvation : StreamArbiter {
+  int Pick(int table, const std::vector<Candidate> &cands) override;
+  /*!
+   * \brief The number of vectors the port can feed (input) or absorb (output)
+   *        before the CGRA stalls.
+   */
+  static double Slack(const Candidate &cand);
 };
 
 }
@@ -0,0 +1,347 @@
+// A standalone micro-benchmark of the stream-dataflow simulator. It drives ssim_t
+// without the host core: DMA requests are served by a flat memory with a fixed latency,
+// and the stream commands are replayed from a script, so that the simulation speed
+// can be measured and profiled in isolation.
+//
+// Usage: ssim_bench script [latency in cycles] [max cycles]
+//
+// The ADG is given by $SBCONFIG or the adg_file in $DSA_SPEC, and the DFG of a
+// "config" is loaded from .sched/<basename>.dfg.json and .sched/<basename>.sched.json,
+// the same as the full system simulation. Each line of the script is one of:
+//
+//   config <basename>                   Load the bitstream of the DFG.
+//   reg <name> <value> [sticky]         Set a stream register, e.g. reg L1D 64.
+//   fill <addr> <n> <bytes> <start> <stride>
+//                                       Initialize n elements in memory.
+//   load <port> <source> <dim> <padding>
+//   write <port> <operation> <dst> <dim> <padding>
+//   indirect <port> <source> <ind> <dim> <penetrate> <associate>
+//   const <port> <dim>
+//   wait <mask>                         Wait until the lanes are done with the mask.
+//
+// Blank lines and the lines start with '#' are ignored.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dsa/debug.h"
+#include "params/MinorCPU.hh"
+#include "sim/core.hh"
+#include "sim/eventq.hh"
+
+#include "./memory.h"
+#include "./ssim.hh"
+
+namespace {
+
+/*!
+ * \brief A flat memory which responds each read after a fixed number of cycles.
+ */
+struct MockMemory : dsa::sim::MemoryInterface {
+  /*!
+   * \param period The ticks of a cycle.
+   * \param latency The cycles before a read is responded.
+   * \param queue_size The entries of the transfer queue of each port.
+   */
+  MockMemory(uint64_t period_, int latency_, int queue_size_)
+      : period(period_), latency(latency_), queue_size(queue_size_) {}
+
+  bool canRequest() override {
+    return true;
+  }
+
+  bool transferAvailable(int port) override {
+    auto &q = queues[port];
+    return (int) q.pending.size() + q.reserved < queue_size;
+  }
+
+  void reserveTransfer(int port) override {
+    DSA_CHECK(transferAvailable(port)) << port;
+    ++queues[port].reserved;
+  }
+
+  void pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                   int size, uint64_t addr, SSMemReqInfo *sdInfo) override {
+    ++requests;
+    if (!isLoad) {
+      for (int i = 0; i < size; ++i) {
+        byteAt(addr + i) = data[i];
+      }
+      dsa::sim::Release(sdInfo);
+      return;
+    }
+    auto &q = queues[sdInfo->trans_idx];
+    if (q.reserved) {
+      --q.reserved;
+    }
+    q.pending.emplace_back();
+    auto &entry = q.pending.back();
+    entry.ready = curTick() + latency * period;
+    entry.addr = addr;
+    entry.sdInfo = sdInfo;
+    entry.data.resize(size);
+    for (int i = 0; i < size; ++i) {
+      entry.data[i] = byteAt(addr + i);
+    }
+  }
+
+  const dsa::sim::MemoryResponse *findResponse(int port) override {
+    auto iter = queues.find(port);
+    if (iter == queues.end() || iter->second.pending.empty()) {
+      return nullptr;
+    }
+    auto &entry = iter->second.pending.front();
+    if (entry.ready > curTick()) {
+      return nullptr;
+    }
+    found.sdInfo = entry.sdInfo;
+    found.addr = entry.addr;
+    found.size = entry.data.size();
+    found.data = entry.data.data();
+    return &found;
+  }
+
+  void popResponse(int port) override {
+    auto &q = queues[port];
+    DSA_CHECK(!q.pending.empty()) << port;
+    dsa::sim::Release(q.pending.front().sdInfo);
+    q.pending.pop_front();
+  }
+
+  bool is_pending_net_empty() override { return true; }
+  bool can_push_net_req(int num_data_bytes) override { return true; }
+  void serve_pending_net_req() override {}
+  void check_cpu_response_queue() override {}
+  void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr,
+                            int data_bytes, int reorder_entry) override {
+    DSA_CHECK(false) << "No remote cores in the benchmark!";
+  }
+  void print_spu_stats(int spu_id) override {}
+
+  uint64_t clockPeriod() override { return period; }
+  int getCpuId() override { return 0; }
+
+  uint8_t &byteAt(uint64_t addr) {
+    auto &page = pages[addr >> 12];
+    if (page.empty()) {
+      page.resize(1 << 12, 0);
+    }
+    return page[addr & 4095];
+  }
+
+  /*! \brief The requests served. */
+  int64_t requests{0};
+
+ private:
+  struct Pending {
+    uint64_t ready;
+    uint64_t addr;
+    SSMemReqInfo *sdInfo;
+    std::vector<uint8_t> data;
+  };
+  struct TransferQueue {
+    std::deque<Pending> pending;
+    int reserved{0};
+  };
+
+  uint64_t period;
+  int latency;
+  int queue_size;
+  std::unordered_map<int, TransferQueue> queues;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> pages;
+  dsa::sim::MemoryResponse found;
+};
+
+/*!
+ * \brief Replay the script against the simulator, cycle by cycle.
+ */
+struct Bench {
+  Bench(ssim_t &ssim_, MockMemory &memory_, int64_t max_cycles_)
+      : ssim(ssim_), memory(memory_), max_cycles(max_cycles_) {}
+
+  /*! \brief Simulate a cycle. */
+  void step() {
+    ssim.step();
+    curEventQueue()->setCurTick(curTick() + memory.clockPeriod());
+    ++cycles;
+    DSA_CHECK(cycles < max_cycles) << "Not done in " << max_cycles << " cycles, deadlocked?";
+  }
+
+  /*! \brief Stall the command like the host core does. */
+  void issue(bool stream) {
+    while (ssim.is_in_config() || (stream && !ssim.StreamBufferAvailable())) {
+      step();
+    }
+    ssim.WakeUp();
+  }
+
+  void setRegister(const std::string &name, uint64_t value, bool sticky) {
+    for (int i = 1; i < DSARF::TOTAL_REG; ++i) {
+      if (name == REG_NAMES[i]) {
+        ssim.rf[i].value = value;
+        ssim.rf[i].sticky = sticky;
+        return;
+      }
+    }
+    DSA_CHECK(false) << "Unknown register " << name;
+  }
+
+  void configure(const std::string &basename) {
+    // The bitstream is only read for the name of the DFG after the 9-byte header.
+    std::vector<uint8_t> bits(9 + basename.size() + 1, 0);
+    memcpy(bits.data() + 9, basename.c_str(), basename.size());
+    int size = (bits.size() + 7) / 8;
+    for (int i = 0; i < size * 8; ++i) {
+      memory.byteAt(config_addr + i) = i < (int) bits.size() ? bits[i] : 0;
+    }
+    setRegister("CSA", config_addr, false);
+    setRegister("CFS", size, false);
+    issue(false);
+    ssim.LoadBitstream();
+  }
+
+  void run(std::istream &is) {
+    std::string line;
+    int lineno = 0;
+    while (std::getline(is, line)) {
+      ++lineno;
+      std::istringstream iss(line);
+      std::string cmd;
+      if (!(iss >> cmd) || cmd[0] == '#') {
+        continue;
+      }
+      std::vector<int64_t> args;
+      std::string name;
+      if (cmd == "config" || cmd == "reg") {
+        iss >> name;
+      }
+      for (int64_t x; iss >> x; ) {
+        args.push_back(x);
+      }
+      auto arity = [&] (int n) {
+        DSA_CHECK((int) args.size() == n) << "Line " << lineno << ": " << line;
+      };
+      if (cmd == "config") {
+        arity(0);
+        configure(name);
+      } else if (cmd == "reg") {
+        DSA_CHECK(args.size() == 1 || args.size() == 2) << "Line " << lineno << ": " << line;
+        setRegister(name, args[0], args.size() == 2 && args[1]);
+        continue;
+      } else if (cmd == "fill") {
+        arity(5);
+        for (int64_t i = 0; i < args[1]; ++i) {
+          int64_t value = args[3] + i * args[4];
+          for (int j = 0; j < args[2]; ++j) {
+            memory.byteAt(args[0] + i * args[2] + j) = value >> (j * 8) & 255;
+          }
+        }
+        continue;
+      } else if (cmd == "load") {
+        arity(4);
+        issue(true);
+        ssim.LoadMemoryToPort(args[0], args[1], args[2], args[3]);
+      } else if (cmd == "write") {
+        arity(5);
+        issue(true);
+        ssim.WritePortToMemory(args[0], args[1], args[2], args[3], args[4]);
+      } else if (cmd == "indirect") {
+        arity(6);
+        issue(true);
+        ssim.IndirectMemoryToPort(args[0], args[1], args[2], args[3], args[4], args[5]);
+      } else if (cmd == "const") {
+        arity(2);
+        issue(true);
+        ssim.ConstStream(args[0], args[1]);
+      } else if (cmd == "wait") {
+        arity(1);
+        issue(ssim_t::stall_core(args[0]));
+        if (ssim_t::stall_core(args[0])) {
+          while (!ssim.done(false, args[0])) {
+            step();
+          }
+        }
+        ssim.InsertBarrier(args[0]);
+      } else {
+        DSA_CHECK(false) << "Line " << lineno << ": Unknown command " << cmd;
+      }
+      ssim.resetNonStickyState();
+      ++commands;
+    }
+    while (!ssim.done(false, 0)) {
+      step();
+    }
+  }
+
+  ssim_t &ssim;
+  MockMemory &memory;
+  int64_t max_cycles;
+  int64_t cycles{0};
+  int64_t commands{0};
+  /*! \brief Where the bitstream is put, away from the data of the script. */
+  const uint64_t config_addr{1ull << 40};
+};
+
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " script [latency in cycles] [max cycles]" << std::endl;
+    return 1;
+  }
+  if (!std::getenv("SBCONFIG") && !std::getenv("DSA_SPEC")) {
+    std::cerr << "Specify the ADG by $SBCONFIG, or the adg_file in $DSA_SPEC!" << std::endl;
+    return 1;
+  }
+  std::ifstream ifs(argv[1]);
+  if (!ifs.good()) {
+    std::cerr << "Cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  int latency = argc > 2 ? atoi(argv[2]) : 100;
+  int64_t max_cycles = argc > 3 ? atoll(argv[3]) : 100000000;
+
+  curEventQueue(getEventQueue(0));
+  curEventQueue()->setCurTick(0);
+
+  // The same as the default clock of the MinorCPU, in ticks.
+  MockMemory memory(500, latency, 32);
+  MinorCPUParams params;
+  params.ssArbiter = "round-robin";
+  params.ssLaneThreads = 0;
+  params.ssSpadBanks = 8;
+  params.ssSpadBankWidth = 8;
+  params.ssSpadFifoDepth = 1;
+  params.ssSpadRobSize = 4;
+  params.ssSpadIssueWidth = 16;
+  params.ssSpadProvision = 1;
+  params.ssSpadBuffer = "input";
+  params.ssFastForward = false;
+  ssim_t ssim(&memory, params);
+  Bench bench(ssim, memory, max_cycles);
+
+  ssim.statistics.roi(true);
+  ssim.roi_entry(true);
+  auto begin = std::chrono::steady_clock::now();
+  bench.run(ifs);
+  auto end = std::chrono::steady_clock::now();
+  ssim.statistics.roi(false);
+  ssim.roi_entry(false);
+
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+  std::cout << "Commands:          " << bench.commands << "\n"
+            << "Memory requests:   " << memory.requests << "\n"
+            << "Simulated cycles:  " << bench.cycles << "\n"
+            << "Host time (s):     " << ns / 1e9 << "\n"
+            << "Host ns/cycle:     " << (bench.cycles ? ns / bench.cycles : 0.0) << std::endl;
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include <algorithm>
+
+#include "dsa/dfg/port.h"
+#include "dsa/dfg/utils.h"
+
+#include "./bitstream.h"
+
+namespace dsa {
+namespace sim {
+
+void BitstreamWrapper::BindPorts(std::vector<InPort> &ips, std::vector<OutPort> &ops) {
+  irecords.clear();
+  orecords.clear();
+
+  auto ivps = sched->ssModel()->subModel()->input_list();
+  DSA_CHECK(ivps.size() > 0) << "No input ports!";
+  for (auto &elem : iports()) {
+    int port_index = elem.port;
+    DSA_CHECK(port_index >= 0 && port_index < ips.size());
+    auto &ip = ips[port_index];
+    ip.vp = elem.vp;
+    auto vp_iter = std::find_if(ivps.begin(), ivps.end(), [port_index] (ssivport *vp) {
+      return vp->port() == port_index;
+    });
+    DSA_CHECK(vp_iter != ivps.end()) << "Cannot find a mapping for input port "
+      << elem.port << " " << elem.vp->name();
+    auto *node = dynamic_cast<dfg::InputPort*>(sched->dfgNodeOf(*vp_iter));
+    DSA_CHECK(node && node == ip.ivp())
+      << (*vp_iter)->name() << " | " << elem.vp->name();
+    irecords.emplace_back(&ip, node, ip.vectorLanes(), node->stated);
+  }
+
+  auto ovps = sched->ssModel()->subModel()->output_list();
+  DSA_CHECK(ovps.size() > 0) << "No output ports!";
+  for (auto &elem : oports()) {
+    int port_index = elem.port;
+    DSA_CHECK(port_index >= 0 && port_index < ops.size());
+    auto &op = ops[port_index];
+    op.vp = elem.vp;
+    auto vp_iter = std::find_if(ovps.begin(), ovps.end(), [port_index] (ssovport *vp) {
+      return vp->port() == port_index;
+    });
+    DSA_CHECK(vp_iter != ovps.end()) << "Cannot find a mapping for output port "
+      << elem.port << " " << elem.vp->name();
+    auto *node = dynamic_cast<dfg::OutputPort*>(sched->dfgNodeOf(*vp_iter));
+    DSA_CHECK(node && node == op.ovp())
+      << (*vp_iter)->name() << ", " << (*vp_iter)->id() << " | " << elem.vp->name();
+    orecords.emplace_back(&op, node, op.scalarSizeInBytes(), node->penetrated_state);
+  }
+}
+
+} // namespace sim
+} // namespace dsa
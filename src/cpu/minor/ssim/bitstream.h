@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -7,6 +9,9 @@
 #include "dsa/arch/model.h"
 #include "dsa/mapper/schedule.h"
 
+#include "./bitstream_cache.h"
+#include "./port.h"
+
 
 namespace dsa {
 namespace sim {
@@ -93,6 +98,72 @@ struct BitstreamWrapper {
   SSDfg *dfg() {
     return sched ? sched->ssdfg() : nullptr;
   }
+
+  /*!
+   * \brief The flattened binding of an active input port, which only changes
+   *        when the accelerator is configured.
+   */
+  struct InputRecord {
+    /*!
+     * \brief The hardware port.
+     */
+    InPort *port;
+    /*!
+     * \brief The DFG node mapped to this port.
+     */
+    dfg::InputPort *node;
+    /*!
+     * \brief The number of vector lanes.
+     */
+    int lanes;
+    /*!
+     * \brief If the first value of the port is the stream state.
+     */
+    int stated;
+
+    InputRecord(InPort *p, dfg::InputPort *n, int l, int s) :
+      port(p), node(n), lanes(l), stated(s) {}
+  };
+
+  /*!
+   * \brief The flattened binding of an active output port.
+   */
+  struct OutputRecord {
+    /*!
+     * \brief The hardware port.
+     */
+    OutPort *port;
+    /*!
+     * \brief The DFG node mapped to this port.
+     */
+    dfg::OutputPort *node;
+    /*!
+     * \brief The scalar data type in bytes.
+     */
+    int dtype;
+    /*!
+     * \brief The stream state to be penetrated, -1 if none.
+     */
+    int penetrated_state;
+
+    OutputRecord(OutPort *p, dfg::OutputPort *n, int d, int ps) :
+      port(p), node(n), dtype(d), penetrated_state(ps) {}
+  };
+
+  /*!
+   * \brief The flattened records of the active input/output ports,
+   *        iterated by the CGRA every cycle.
+   */
+  std::vector<InputRecord> irecords;
+  std::vector<OutputRecord> orecords;
+
+  /*!
+   * \brief Bind the configured vector ports to the hardware ports,
+   *        and build the flattened records.
+   * \param ips The input ports of the accelerator.
+   * \param ops The output ports of the accelerator.
+   */
+  void BindPorts(std::vector<InPort> &ips, std::vector<OutPort> &ops);
 };
 
 }
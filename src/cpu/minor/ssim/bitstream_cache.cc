@@ -0,0 +1,85 @@
+#include <sys/stat.h>
+
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "dsa/dfg/utils.h"
+
+#include "./bitstream_cache.h"
+
+namespace dsa {
+namespace sim {
+
+int64_t BitstreamCache::parsed = 0;
+int64_t BitstreamCache::hits = 0;
+int64_t BitstreamCache::reimported = 0;
+
+namespace {
+
+/*!
+ * \brief The modification time of the given file in nanoseconds, -1 if absent.
+ */
+int64_t modifiedAt(const std::string &fname) {
+  struct stat st;
+  if (stat(fname.c_str(), &st)) {
+    return -1;
+  }
+  return (int64_t) st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+}
+
+} // namespace
+
+std::shared_ptr<const BitstreamCache::Entry>
+BitstreamCache::Get(const std::string &basename) {
+  // Cores may be simulated by different event queues.
+  static std::mutex mtx;
+  static std::unordered_map<std::string, std::shared_ptr<const Entry>> entries;
+
+  std::string prefix = ".sched/" + basename;
+  int64_t mtime[2] = {modifiedAt(prefix + ".dfg.json"),
+                      modifiedAt(prefix + ".sched.json")};
+
+  std::lock_guard<std::mutex> lock(mtx);
+  auto iter = entries.find(basename);
+  if (iter != entries.end() &&
+      iter->second->mtime[0] == mtime[0] && iter->second->mtime[1] == mtime[1]) {
+    ++hits;
+    return iter->second;
+  }
+
+  auto entry = std::make_shared<Entry>();
+  entry->basename = basename;
+  entry->mtime[0] = mtime[0];
+  entry->mtime[1] = mtime[1];
+  entry->dfg = dsa::dfg::Import(prefix + ".dfg.json");
+  ++parsed;
+  DSA_LOG(CONFIG) << "Parsed bitstream " << basename << ", "
+                  << parsed << " parsed, " << hits << " hits";
+  entries[basename] = entry;
+  return entry;
+}
+
+bool BitstreamCache::Aliased(const SSDfg &a, const SSDfg &b) {
+  std::unordered_set<const void*> nodes(a.nodes.begin(), a.nodes.end());
+  for (auto *node : b.nodes) {
+    if (nodes.count(node)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BitstreamCache::Instantiate(const Entry &entry, SSDfg &dfg) {
+  dfg = entry.dfg;
+  if (Aliased(dfg, entry.dfg)) {
+    // A shallow copy would share the operand fifos with every other lane.
+    DSA_WARNING << "The copy of bitstream " << entry.basename
+                << " shares nodes with the cache, import it again!";
+    dfg = dsa::dfg::Import(".sched/" + entry.basename + ".dfg.json");
+    ++reimported;
+  }
+}
+
+} // namespace sim
+} // namespace dsa
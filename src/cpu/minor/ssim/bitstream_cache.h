@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "dsa/debug.h"
+#include "dsa/mapper/schedule.h"
+
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief The process-wide cache of parsed bitstreams. All the lanes, and all the
+ *        cores, configured with the same SS_CFG share one parsed dataflow graph.
+ *        Only the graph is cached: the Schedule and the port tables hold pointers into
+ *        the graph of their lane, and the mapper offers no way to retarget them to another
+ *        copy, so each lane still loads the .sched.json and binds its ports on configure.
+ */
+struct BitstreamCache {
+  /*!
+   * \brief A parsed bitstream.
+   */
+  struct Entry {
+    /*!
+     * \brief The name of the bitstream, the files are .sched/<basename>.*.json.
+     */
+    std::string basename;
+    /*!
+     * \brief The modification time of the .dfg.json and .sched.json when parsed.
+     */
+    int64_t mtime[2]{-1, -1};
+    /*!
+     * \brief The pristine dataflow graph. It is never simulated, because the graph
+     *        carries the simulation state, each lane copies its own instance.
+     */
+    SSDfg dfg;
+  };
+
+  /*!
+   * \brief Get the parsed bitstream. The files are only re-parsed when either of
+   *        them is modified on the disk after the last parsing.
+   * \param basename The name of the bitstream.
+   */
+  static std::shared_ptr<const Entry> Get(const std::string &basename);
+
+  /*!
+   * \brief Copy the pristine graph of the entry to the graph simulated by a lane.
+   *        The lanes may be ticked by the workers in parallel, so the copy is checked to
+   *        share no node with the entry. If it does, the graph is imported again instead.
+   * \param entry The parsed bitstream.
+   * \param dfg The graph of the lane, overwritten.
+   */
+  static void Instantiate(const Entry &entry, SSDfg &dfg);
+
+  /*!
+   * \brief If the two graphs share any node, and so the state of the simulation.
+   */
+  static bool Aliased(const SSDfg &a, const SSDfg &b);
+
+  /*!
+   * \brief The number of parsings, cache hits, and copies imported again, for debugging.
+   */
+  static int64_t parsed;
+  static int64_t hits;
+  static int64_t reimported;
+};
+
+}
+}
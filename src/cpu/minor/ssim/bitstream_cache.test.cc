@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "./bitstream_cache.h"
+
+using dsa::sim::BitstreamCache;
+
+/*!
+ * \brief Two lanes configured from one cached bitstream simulate disjoint graphs.
+ *        The bitstream is .sched/$DSA_TEST_BITSTREAM.*.json, compiled by the dsa
+ *        toolchain, so the test passes trivially when it is not given.
+ */
+TEST(BitstreamCacheTest, LanesDoNotAliasNodes)
+{
+  const char *basename = std::getenv("DSA_TEST_BITSTREAM");
+  if (!basename) {
+    std::cout << "DSA_TEST_BITSTREAM is not set, nothing to check." << std::endl;
+    return;
+  }
+
+  auto entry = BitstreamCache::Get(basename);
+  ASSERT_EQ(entry, BitstreamCache::Get(basename));
+  ASSERT_FALSE(entry->dfg.nodes.empty());
+
+  SSDfg a, b;
+  BitstreamCache::Instantiate(*entry, a);
+  BitstreamCache::Instantiate(*entry, b);
+  ASSERT_EQ(a.nodes.size(), entry->dfg.nodes.size());
+  ASSERT_EQ(b.nodes.size(), entry->dfg.nodes.size());
+  EXPECT_FALSE(BitstreamCache::Aliased(a, entry->dfg));
+  EXPECT_FALSE(BitstreamCache::Aliased(b, entry->dfg));
+  EXPECT_FALSE(BitstreamCache::Aliased(a, b));
+  EXPECT_EQ(BitstreamCache::reimported, 0);
+
+  // The state simulated by one lane is invisible to the other and the cache.
+  for (int i = 0; i < (int) a.nodes.size(); ++i) {
+    if (a.nodes[i]->values.empty()) {
+      continue;
+    }
+    a.nodes[i]->values[0].push(1, true, 0);
+    EXPECT_FALSE(a.nodes[i]->values[0].fifo.empty());
+    EXPECT_TRUE(b.nodes[i]->values[0].fifo.empty());
+    EXPECT_TRUE(entry->dfg.nodes[i]->values[0].fifo.empty());
+  }
+}
@@ -0,0 +1,91 @@
+#include <sstream>
+
+#include "dsa/debug.h"
+
+#include "./buffet.h"
+
+#define CQ_PTR(x, delta)               \
+  do {                                 \
+    x += (delta);                      \
+    if (x >= end) {                    \
+      x = begin + (x) - end;           \
+      DSA_CHECK(x >= begin && x <= end);   \
+    }                                  \
+  } while (false)
+
+bool BuffetEntry::EnforceReadWrite(int64_t addr, int word) {
+  if (mo == MemoryOperation::DMO_Read) {
+    return InRange(addr);
+  } else if (mo == MemoryOperation::DMO_Write) {
+    return addr >= address && addr < address + Size();
+  }
+  DSA_CHECK(false) << "Not supported yet!";
+  return false;
+}
+
+int64_t BuffetEntry::Translate(int64_t addr, MemoryOperation mo) {
+  switch (mo) {
+  case DMO_Write:
+    DSA_CHECK(SpaceAvailable() && addr == address + occupied)
+      << "For now only appended writing is supported!"
+      << "request: " << addr << ", address: [" << address << ", " << address + occupied << ")"
+      << ", Size: " << Size();
+    break;
+  case DMO_Read:
+    DSA_CHECK(InRange(addr))
+      << "Address out of range: " << addr << " not in ["
+      << address << ", " << address + occupied << ")";
+    break;
+  default:
+    DSA_CHECK(false) << "Not supported: " << mo;
+  }
+  CQ_PTR(addr, front - address);
+  return addr;
+}
+
+void BuffetEntry::Append(int bytes) {
+  DSA_CHECK(occupied + bytes <= Size())
+    << "Buffet size overflow!" << occupied << " " << bytes << " " << Size();
+  occupied += bytes;
+  CQ_PTR(tail, bytes);
+  if (bytes) {
+    DSA_LOG(BUFFET) << "Append " << bytes << ", now: " << toString();
+  }
+}
+
+void BuffetEntry::Shrink(int bytes) {
+  DSA_CHECK(occupied - bytes >= 0)
+    << "Buffet size underflow!" << occupied << " " << bytes << " " << Size();
+  occupied -= bytes;
+  address += bytes;
+  CQ_PTR(front, bytes);
+  if (bytes) {
+    DSA_LOG(BUFFET) << "Pop " << bytes << ", now: " << toString();
+  }
+}
+
+#undef CQ_PTR
+
+int BuffetEntry::SpaceAvailable() {
+  int64_t res = 0;
+  if (front < tail) {
+    res = tail - front;
+  } else {
+    res = (end - front) + (tail - begin);
+  }
+  if (res != occupied) {
+    DSA_CHECK(occupied == 0 || occupied == end - begin)
+      << occupied << " ? " << end - begin << " | "
+      << front << ", " << tail;
+  }
+  return Size() - occupied;
+}
+
+std::string BuffetEntry::toString() {
+  std::ostringstream oss;
+  oss << "Alloc: [" << begin << ", " << end << "), Ptr: ["
+      << front << ", " << tail << "), Buffered: [" << address
+      << ", " << address + occupied << "), occupied: "
+      << occupied << ", space: " << SpaceAvailable();
+  return oss.str();
+}
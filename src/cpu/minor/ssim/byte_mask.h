@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "dsa/debug.h"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief The predicate of each byte of a memory line. It is held in place by a fixed
+ *        number of words, so passing it along the requests and responses costs no heap
+ *        allocation, and counting and scanning the bytes are done word by word.
+ */
+struct ByteMask {
+  /*!
+   * \brief The widest mask supported, in bytes predicated.
+   */
+  static const int MAX_BITS = 512;
+
+  ByteMask() {}
+
+  /*!
+   * \brief A mask of n bytes, all set to the value.
+   */
+  explicit ByteMask(int n_, bool value = false) : n(n_) {
+    DSA_CHECK(n >= 0 && n <= MAX_BITS) << n << " bytes exceed the widest mask";
+    if (value) {
+      fill(0, n);
+    }
+  }
+
+  int size() const { return n; }
+
+  bool empty() const { return n == 0; }
+
+  bool operator[](int i) const {
+    return bits[i >> 6] >> (i & 63) & 1;
+  }
+
+  void set(int i, bool value = true) {
+    if (value) {
+      bits[i >> 6] |= 1ull << (i & 63);
+    } else {
+      bits[i >> 6] &= ~(1ull << (i & 63));
+    }
+  }
+
+  /*!
+   * \brief Set the bytes in [l, r) to the value.
+   */
+  void fill(int l, int r, bool value = true) {
+    DSA_CHECK(0 <= l && l <= r && r <= n) << "[" << l << ", " << r << ") not in " << n;
+    while (l < r) {
+      int w = l >> 6;
+      int hi = std::min(r, (w + 1) << 6);
+      uint64_t bits_ = (hi - l == 64 ? ~0ull : ((1ull << (hi - l)) - 1)) << (l & 63);
+      if (value) {
+        bits[w] |= bits_;
+      } else {
+        bits[w] &= ~bits_;
+      }
+      l = hi;
+    }
+  }
+
+  /*!
+   * \brief The number of bytes set.
+   */
+  int count() const {
+    int res = 0;
+    for (int i = 0, m = words(); i < m; ++i) {
+      res += __builtin_popcountll(bits[i]);
+    }
+    return res;
+  }
+
+  /*!
+   * \brief If any byte is set.
+   */
+  bool any() const {
+    for (int i = 0, m = words(); i < m; ++i) {
+      if (bits[i]) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*!
+   * \brief The first byte set at or after i, or size() if there is none.
+   */
+  int next(int i) const {
+    if (i >= n) {
+      return n;
+    }
+    int w = i >> 6;
+    uint64_t word = bits[w] & (~0ull << (i & 63));
+    while (!word) {
+      if (++w >= words()) {
+        return n;
+      }
+      word = bits[w];
+    }
+    return (w << 6) + __builtin_ctzll(word);
+  }
+
+  /*!
+   * \brief Call f on the index of each byte set, in ascending order.
+   */
+  template<typename F>
+  void forEach(F f) const {
+    for (int i = 0, m = words(); i < m; ++i) {
+      for (uint64_t word = bits[i]; word; word &= word - 1) {
+        f((i << 6) + __builtin_ctzll(word));
+      }
+    }
+  }
+
+  /*!
+   * \brief The bytes in [l, r) as a new mask.
+   */
+  ByteMask slice(int l, int r) const {
+    DSA_CHECK(0 <= l && l <= r && r <= n) << "[" << l << ", " << r << ") not in " << n;
+    ByteMask res(r - l);
+    for (int i = 0, m = res.words(); i < m; ++i) {
+      int from = l + (i << 6);
+      uint64_t lo = bits[from >> 6] >> (from & 63);
+      if ((from & 63) && (from >> 6) + 1 < words()) {
+        lo |= bits[(from >> 6) + 1] << (64 - (from & 63));
+      }
+      res.bits[i] = lo;
+    }
+    res.clearTail();
+    return res;
+  }
+
+  /*!
+   * \brief Concatenate the other mask after this one.
+   */
+  void append(const ByteMask &other) {
+    DSA_CHECK(n + other.n <= MAX_BITS) << n << " + " << other.n << " bytes exceed the widest mask";
+    int shift = n & 63;
+    int w = n >> 6;
+    n += other.n;
+    for (int i = 0, m = other.words(); i < m; ++i) {
+      bits[w + i] |= other.bits[i] << shift;
+      if (shift && w + i + 1 < WORDS) {
+        bits[w + i + 1] |= other.bits[i] >> (64 - shift);
+      }
+    }
+    clearTail();
+  }
+
+  bool operator==(const ByteMask &other) const {
+    return n == other.n && !memcmp(bits, other.bits, words() * sizeof(uint64_t));
+  }
+
+  bool operator!=(const ByteMask &other) const {
+    return !(*this == other);
+  }
+
+  /*!
+   * \brief The 0/1 string of the mask for debugging.
+   */
+  std::string toString() const {
+    std::string res(n, '0');
+    forEach([&res] (int i) { res[i] = '1'; });
+    return res;
+  }
+
+ private:
+  static const int WORDS = MAX_BITS / 64;
+
+  int words() const { return (n + 63) >> 6; }
+
+  /*!
+   * \brief Keep the bits beyond the size zero, so that words can be compared and counted.
+   */
+  void clearTail() {
+    for (int i = words(); i < WORDS; ++i) {
+      bits[i] = 0;
+    }
+    if (n & 63) {
+      bits[n >> 6] &= (1ull << (n & 63)) - 1;
+    }
+  }
+
+  uint64_t bits[WORDS]{};
+  int n{0};
+};
+
+}
+}
@@ -28,6 +28,4 @@ DO_DBG(VERIF_CGRA)
 DO_DBG(VERIF_SCR)
 DO_DBG(VERIF_CMD)
 
-DO_DBG(CHECK_SCR_ALIAS)
-
 DO_DBG(UNREAL_INPUTS)
@@ -0,0 +1,466 @@
+#include "./dispatcher.h"
+
+#include <algorithm>
+
+#include "./accel.hh"
+#include "./ssim.hh"
+#include "./stream.hh"
+
+namespace dsa {
+namespace sim {
+
+namespace {
+
+using Reason = stat::Accelerator::DispatchBlock;
+
+struct DispatchChecker : stream::Functor {
+  DispatchChecker(accel_t *accel_) :
+    accel(accel_), iports(accel_->input_ports.size()), oports(accel_->output_ports.size()) {}
+
+  /*!
+   * \brief Record why the stream is blocked.
+   */
+  bool Block(Reason reason_, int port_, bool is_input_) {
+    reason = reason_;
+    port = port_;
+    is_input = is_input_;
+    return false;
+  }
+
+  /*!
+   * \brief Check the avaiability of the ports of this stream.
+   * \param is The input stream to be scheduled.
+   */
+  bool IVPAvailable(const std::vector<PortExecState> &pes) {
+    for (auto &elem : pes) {
+      auto &in = accel->input_ports[elem.port];
+      if (in.stream) {
+        DSA_LOG(CMD_BLOCK) << "ivp" << elem.port << " serving stream " << in.stream->toString();
+        return Block(Reason::PORT_BUSY, elem.port, true);
+      }
+      if (iports[elem.port]) {
+        DSA_LOG(CMD_BLOCK) << "ivp" << elem.port << " is enforced by previous conflict port!";
+        return Block(Reason::PORT_BUSY, elem.port, true);
+      }
+      if (!in.buffer.empty()) {
+        DSA_LOG(CMD_BLOCK)
+          << "ivp" << elem.port << " buffer not empty! Buffer: "
+          << in.buffer.size();
+        if (in.pes.exec_repeat() == 1 && in.pes.stretch == 0) {
+          if (elem.repeat == in.pes.repeat && elem.stretch == in.pes.stretch) {
+            DSA_LOG(CMD_BLOCK) << "However, repeat matches, skip!";
+            continue;
+          }
+        }
+        return Block(Reason::BUFFER_NON_EMPTY, elem.port, true);
+        // FIXME(@were): This can be more aggressive, but what should I do?
+        // if (elem.repeat != in.pes.repeat ||
+        //     elem.period != in.pes.period ||
+        //     elem.stretch != in.pes.stretch) {
+        //   return false;
+        // }
+      }
+    }
+    return true;
+  }
+
+  bool OVPAvailable(const std::vector<int> &ports) {
+    for (auto port : ports) {
+      auto &out = accel->output_ports[port];
+      if (out.stream) {
+        DSA_LOG(CMD_BLOCK) << "ovp" << port << " is serving " << out.stream->toString();
+        return Block(Reason::PORT_BUSY, port, false);
+      }
+      if (oports[port]) {
+        DSA_LOG(CMD_BLOCK) << "ovp" << port << " is enforced by conflict streams!";
+        return Block(Reason::PORT_BUSY, port, false);
+      }
+    }
+    return true;
+  }
+
+  /*!
+   * \brief If the stream is blocked by a barrier before it.
+   */
+  bool Barred(base_stream_t *s) {
+    if (s->barrier_mask() & barrier_mask) {
+      Block(Reason::BARRIER, -1, false);
+      return true;
+    }
+    return false;
+  }
+
+  /*!
+   * \brief Enforce the barrier.
+   */
+  void Visit(Barrier *bar) override {
+    // Add the bits to be blocked.
+    barrier_mask |= bar->_mask;
+    // A barrier indicates to enforce the order of execution of streams
+    // (before, after, and bar itself) that have bit masks in common.
+    // If there are streams (either active or wait in FIFO) before
+    // this barrier are seperated by this barrier, this barrier should not retire.
+    Block(Reason::BARRIER, -1, false);
+    if (bar->_mask & barred) {
+      DSA_LOG(BAR) << "Cannot retire because of prior streams.";
+      return;
+    }
+    // If there are active stream affected by this barrier,
+    // this barrier should not retire.
+    for (auto &i : accel->bsw.iports()) {
+      auto &in = accel->input_ports[i.port];
+      if (in.stream && (in.stream->barrier_mask() & bar->_mask)) {
+        DSA_LOG(BAR) << "Cannot retire because of active streams.";
+        return;
+      }
+    }
+    for (auto &i : accel->bsw.oports()) {
+      auto &out = accel->output_ports[i.port];
+      if (out.stream && (out.stream->barrier_mask() & bar->_mask)) {
+        DSA_LOG(BAR) << "Cannot retire because of active streams.";
+        return;
+      }
+    }
+    // If no stream is affected by this barrier, retire.
+    retire = true;
+  }
+
+  /*!
+   * \brief Schedule the read stream.
+   */
+  void Visit(IPortStream *ips) override {
+    barred |= ips->barrier_mask();
+    // (not blocked by barrier) && (input ports available)
+    retire = !Barred(ips) && IVPAvailable(ips->pes);
+    for (auto &elem : ips->pes) {
+      iports[elem.port] = true;
+    }
+  }
+
+  /*!
+   * \brief Schedule the write stream.
+   */
+  void Visit(OPortStream *ops) override {
+    barred |= ops->barrier_mask();
+    // (not blocked by barrier) && (output ports available)
+    retire = !Barred(ops) && OVPAvailable(ops->oports());
+    for (auto port : ops->oports()) {
+      oports[port] = true;
+    }
+  }
+
+  /*!
+   * \brief Schedule a port to port stream.
+   */
+  void Visit(PortPortStream *pps) override {
+    barred |= pps->barrier_mask();
+    // (not blocked by barrier) && (output ports available) && (input ports available)
+    retire = !Barred(pps) &&
+             OVPAvailable(pps->oports) &&
+             IVPAvailable(pps->pes);
+    for (auto &elem : pps->pes) {
+      iports[elem.port] = true;
+    }
+    for (auto port : pps->oports) {
+      oports[port] = true;
+    }
+  }
+
+  /*!
+   * \brief Enforce the streams after as the stream checked before, without checking it again.
+   */
+  void Enforce(base_stream_t *s, uint64_t bar_mask,
+               const std::vector<int> &ips, const std::vector<int> &ops) {
+    barred |= s->barrier_mask();
+    barrier_mask |= bar_mask;
+    for (auto port : ips) {
+      iports[port] = true;
+    }
+    for (auto port : ops) {
+      oports[port] = true;
+    }
+  }
+
+  /*!
+   * \brief Reset the status after each scheduling.
+   */
+  void Reset() {
+    retire = false;
+    reason = Reason::PORT_BUSY;
+    port = -1;
+  }
+
+  /*!
+   * \brief The mask of blocking.
+   */
+  uint64_t barrier_mask{0};
+  /*!
+   * \brief This accelerator.
+   */
+  accel_t *accel;
+  /*!
+   * \brief If this scheduled instruction should be removed from the FIFO.
+   */
+  bool retire{false};
+  /*!
+   * \brief The barrier scoreboard.
+   */
+  uint64_t barred{0};
+  /*!
+   * \brief The ports occupied by prior streams. For example, both indirect streams
+            and port-port streams involve both input and output ports. These stream
+            can only be scheduled when both input and output ports are available.
+            Partial avaiability may affect the port-enforced stream order.
+   */
+  std::vector<bool> iports, oports;
+  /*!
+   * \brief Why the stream checked is blocked, and the port waited.
+   */
+  Reason reason{Reason::PORT_BUSY};
+  int port{-1};
+  bool is_input{false};
+};
+
+struct StreamDispatcher : stream::Functor {
+  StreamDispatcher(accel_t *accel_) : accel(accel_) {}
+
+  /*!
+   * \brief Update the status of ports involved by the scheduled stream.
+   * \param is The scheduled stream.
+   */
+  void BindStreamToPorts(const std::vector<PortExecState> &pes, base_stream_t *stream) {
+    for (auto &elem : pes) {
+      auto &ivp = accel->input_ports[elem.port];
+      ivp.bindStream(stream);
+      ivp.pes = elem;
+    }
+  }
+
+  void BindStreamToPorts(const std::vector<int> &ports, base_stream_t *stream) {
+    for (auto &elem : ports) {
+      accel->output_ports[elem].bindStream(stream);
+    }
+  }
+
+  void debugLog(base_stream_t *s0, base_stream_t *s1) {
+    DSA_LOG(DISPATCH)
+      << "[" << accel->get_ssim()->CurrentCycle() << "]: [" << s0
+      << "] Issue to Accel" << accel->accel_index() << " " << s1->toString();
+  }
+
+  /*!
+   * \brief Schedule the read stream.
+   */
+  void Visit(IPortStream *ips) override {
+    auto cloned = ips->clone(accel);
+    BindStreamToPorts(cloned->pes, cloned);
+    debugLog(ips, cloned);
+  }
+
+  /*!
+   * \brief Schedule the write stream.
+   */
+  void Visit(OPortStream *ops) override {
+    auto cloned = ops->clone(accel);
+    BindStreamToPorts(ops->oports(), cloned);
+    debugLog(ops, cloned);
+  }
+
+  /*!
+   * \brief Schedule a port to port stream.
+   */
+  void Visit(PortPortStream *pps) override {
+    auto cloned = pps->clone(accel);
+    BindStreamToPorts(pps->pes, cloned);
+    for (auto elem : pps->oports) {
+      auto &out = accel->output_ports[elem];
+      out.bindStream(cloned);
+    }
+    debugLog(pps, cloned);
+  }
+
+  /*!
+   * \brief This accelerator.
+   */
+  accel_t *accel;
+};
+
+/*!
+ * \brief Collect the ports and the barrier bits a command enforces on the commands after it.
+ */
+struct EnforceCollector : stream::Functor {
+  void Visit(Barrier *bar) override {
+    bar_mask = bar->_mask;
+  }
+
+  void Visit(IPortStream *ips) override {
+    for (auto &elem : ips->pes) {
+      iports.push_back(elem.port);
+    }
+  }
+
+  void Visit(OPortStream *ops) override {
+    oports = ops->oports();
+  }
+
+  void Visit(PortPortStream *pps) override {
+    for (auto &elem : pps->pes) {
+      iports.push_back(elem.port);
+    }
+    oports = pps->oports;
+  }
+
+  uint64_t bar_mask{0};
+  std::vector<int> iports, oports;
+};
+
+}
+
+CommandDispatcher::Pending::Pending(base_stream_t *cmd_) : cmd(cmd_) {
+  EnforceCollector ec;
+  cmd->Accept(&ec);
+  bar_mask = ec.bar_mask;
+  iports = std::move(ec.iports);
+  oports = std::move(ec.oports);
+}
+
+CommandDispatcher::CommandDispatcher(ssim_t *ssim_) :
+  ssim(ssim_), blocked(ssim_->lanes.size(), -1) {}
+
+void CommandDispatcher::Wake() {
+  auto &lanes = ssim->lanes;
+  for (auto &p : pending) {
+    if (p.dirty) {
+      continue;
+    }
+    auto *lane = lanes[p.lane];
+    switch (p.reason) {
+    case Reason::PORT_BUSY: {
+      auto &freed = lane->freed_ports[p.is_input];
+      p.dirty = std::find(freed.begin(), freed.end(), p.port) != freed.end();
+      break;
+    }
+    case Reason::BUFFER_NON_EMPTY:
+      p.dirty = lane->input_ports[p.port].buffer.empty();
+      break;
+    case Reason::BARRIER:
+      // A barrier retires when the streams it waits for are freed.
+      p.dirty = !lane->freed_ports[0].empty() || !lane->freed_ports[1].empty();
+      break;
+    default:
+      DSA_CHECK(false) << "Unknown reason " << p.reason;
+    }
+  }
+  for (auto *lane : lanes) {
+    lane->freed_ports[0].clear();
+    lane->freed_ports[1].clear();
+  }
+}
+
+void CommandDispatcher::Dispatch() {
+  auto &lanes = ssim->lanes;
+  auto &cmd_queue = ssim->cmd_queue;
+  // The commands are only appended by the host.
+  for (int i = pending.size(); i < (int) cmd_queue.size(); ++i) {
+    pending.emplace_back(cmd_queue[i]);
+  }
+  Wake();
+
+  if (std::any_of(pending.begin(), pending.end(), [] (const Pending &p) { return p.dirty; })) {
+    std::vector<DispatchChecker> dc;
+    std::vector<StreamDispatcher> sd;
+    for (int i = 0; i < (int) lanes.size(); ++i) {
+      dc.emplace_back(lanes[i]);
+      sd.emplace_back(lanes[i]);
+    }
+
+    DSA_LOG(DISPATCH) << cmd_queue.size() << " streams to be dispatched!";
+    bool retired = false;
+    for (int i = 0; i < (int) pending.size(); ++i) {
+      auto &p = pending[i];
+      if (!p.dirty) {
+        for (int j = 0; j < (int) lanes.size(); ++j) {
+          if (p.checked >> j & 1) {
+            dc[j].Enforce(p.cmd, p.bar_mask, p.iports, p.oports);
+          }
+        }
+        continue;
+      }
+      p.dirty = false;
+      p.checked = 0;
+      bool retire = true;
+      if (p.cmd->stream_active()) {
+        for (int j = 0; j < (int) lanes.size(); ++j) {
+          if (p.cmd->context >> j & 1) {
+            p.checked |= 1ull << j;
+            p.cmd->Accept(&dc[j]);
+            retire = retire && dc[j].retire;
+            if (!retire) {
+              DSA_LOG(CMD_BLOCK) << "Cannot Issue Stream: " << p.cmd->toString();
+              p.reason = dc[j].reason;
+              p.lane = j;
+              p.port = dc[j].port;
+              p.is_input = dc[j].is_input;
+              break;
+            }
+          }
+        }
+        if (retire) {
+          for (int j = 0; j < (int) lanes.size(); ++j) {
+            if (p.cmd->context >> j & 1) {
+              p.cmd->Accept(&sd[j]);
+            }
+          }
+        }
+        for (int j = 0; j < (int) lanes.size(); ++j) {
+          if (p.cmd->context >> j & 1) {
+            dc[j].Reset();
+          }
+        }
+      }
+      if (retire) {
+        // Either the lanes are bound with new streams, or the blame of idle lanes
+        // may change, so that all of them should be ticked.
+        ssim->WakeUp();
+        // The commands after no longer wait for the ports and the barrier bits of this one.
+        for (int k = i + 1; k < (int) pending.size(); ++k) {
+          auto &q = pending[k];
+          auto &ports = q.is_input ? p.iports : p.oports;
+          q.dirty = q.dirty || q.reason == Reason::BARRIER ||
+                    std::find(ports.begin(), ports.end(), q.port) != ports.end();
+        }
+        p.cmd = nullptr;
+        retired = true;
+      }
+    }
+
+    if (retired) {
+      pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                   [] (const Pending &p) { return !p.cmd; }),
+                    pending.end());
+      cmd_queue.clear();
+      for (auto &p : pending) {
+        cmd_queue.push_back(p.cmd);
+      }
+    }
+
+    // The oldest command of each lane tells why the lane is blocked.
+    std::fill(blocked.begin(), blocked.end(), -1);
+    for (auto &p : pending) {
+      for (int j = 0; j < (int) lanes.size(); ++j) {
+        if ((p.cmd->context >> j & 1) && blocked[j] == -1) {
+          blocked[j] = p.reason;
+        }
+      }
+    }
+  }
+
+  for (int j = 0; j < (int) lanes.size(); ++j) {
+    if (blocked[j] != -1) {
+      lanes[j]->statistics.blockDispatch((Reason) blocked[j]);
+    }
+  }
+}
+
+}
+}
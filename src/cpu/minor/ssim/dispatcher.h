@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "./statistics.h"
+
+class ssim_t;
+struct base_stream_t;
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief Dispatch the commands queued to the lanes. A command blocked remembers what it waits
+ *        for, and is only checked again when that changes: the stream of the port is freed,
+ *        the buffer of the input port drains, or a command before it leaves the queue, which
+ *        gives up the ports it enforces and retires the barrier.
+ */
+struct CommandDispatcher {
+  using Reason = stat::Accelerator::DispatchBlock;
+
+  CommandDispatcher(ssim_t *ssim);
+
+  /*!
+   * \brief Dispatch the commands which can be, in the order of the queue,
+   *        and count this cycle on the reason each lane is blocked.
+   */
+  void Dispatch();
+
+ private:
+  /*!
+   * \brief The state of a command queued, in the same order as the queue.
+   */
+  struct Pending {
+    base_stream_t *cmd;
+    /*! \brief The ports of the command, which the commands after it cannot overtake. */
+    std::vector<int> iports, oports;
+    /*! \brief The barrier bits of the command, if it is a barrier. */
+    uint64_t bar_mask{0};
+    /*! \brief If the command should be checked in the next dispatch. */
+    bool dirty{true};
+    /*! \brief The lanes checked in the last dispatch, before the one blocked. */
+    uint64_t checked{0};
+    /*! \brief Why the command is blocked. */
+    Reason reason{Reason::PORT_BUSY};
+    /*! \brief The lane the command is blocked at. */
+    int lane{-1};
+    /*! \brief The port waited, or -1 for the barrier. */
+    int port{-1};
+    /*! \brief If the port waited is an input port. */
+    bool is_input{false};
+
+    Pending(base_stream_t *cmd);
+  };
+
+  /*! \brief Mark the commands waiting for the events since the last dispatch. */
+  void Wake();
+
+  ssim_t *ssim;
+  std::vector<Pending> pending;
+  /*! \brief The reason each lane is blocked, or -1 if no command of the lane is blocked. */
+  std::vector<int> blocked;
+};
+
+}
+}
@@ -0,0 +1,302 @@
+#include "./gem5_stats.h"
+
+#include "./accel.hh"
+#include "./ssim.hh"
+
+namespace dsa {
+namespace stat {
+
+void Mirror::track(std::function<double()> counter, std::function<void(double)> stat) {
+  entries.push_back({counter, stat, counter()});
+}
+
+void Mirror::resetStats() {
+  Stats::Group::resetStats();
+  for (auto &entry : entries) {
+    entry.base = entry.counter();
+  }
+}
+
+void Mirror::preDumpStats() {
+  for (auto &entry : entries) {
+    entry.stat(entry.counter() - entry.base);
+  }
+  Stats::Group::preDumpStats();
+}
+
+namespace {
+
+/*! \brief The states of a request in the LSQ, which break the memory latency down. */
+const char *LSQ_STATE_NAME[] = {
+  "NotIssued", "InTranslation", "Translated", "Failed", "RequestIssuing",
+  "StoreToStoreBuffer", "RequestNeedsRetry", "StoreInStoreBuffer", "StoreBufferIssuing",
+  "StoreBufferNeedsRetry", "Complete",
+};
+
+const char *STREAM_PATTERN_NAME[] = {
+  "PURE_CONTIG", "REPEATED", "STRIDE", "OVERLAP", "CONST", "REC", "IND", "NONE", "OTHER",
+};
+
+}
+
+LaneStats::LaneStats(Stats::Group *parent, const char *name, accel_t &lane)
+    : Mirror(parent, name),
+      ADD_STAT(commandsIssued, "Stream commands issued"),
+      ADD_STAT(instances, "Instances of the DFG computed"),
+      ADD_STAT(dynamicInsts, "DFG instructions executed"),
+      ADD_STAT(cgraBusyCycles, "Cycles the CGRA issued any instruction"),
+      ADD_STAT(scratchReads, "Scratchpad reads"),
+      ADD_STAT(scratchWrites, "Scratchpad writes"),
+      ADD_STAT(scratchReadBytes, "Bytes read from the scratchpad"),
+      ADD_STAT(scratchWriteBytes, "Bytes written to the scratchpad"),
+      ADD_STAT(writeUnitBubbles, "Write stream bubbles bound by the transfer queue"),
+      ADD_STAT(gatherElements, "Indirect DMA elements gathered"),
+      ADD_STAT(gatherLines, "Line requests of the indirect DMA gathers"),
+      ADD_STAT(prefetchIssued, "Stream prefetches issued"),
+      ADD_STAT(prefetchUseful, "Stream prefetches demanded later"),
+      ADD_STAT(prefetchLeadCycles, "Total cycles from the useful prefetches to their demands"),
+      ADD_STAT(prefetchCoveredLatency, "Total cycles of the DMA read responses prefetched"),
+      ADD_STAT(memoryLatency, "Total cycles of the DMA read responses"),
+      ADD_STAT(memoryLatencyBreakdown,
+               "Total cycles of the DMA read responses since entering each LSQ state"),
+      ADD_STAT(blame, "Cycles blamed on each reason"),
+      ADD_STAT(dispatchBlocked, "Cycles the oldest command is blocked from dispatching"),
+      ADD_STAT(dmaServiceRequests, "DMA reads served by each level of the memory"),
+      ADD_STAT(dmaServiceLatency, "Total cycles of the DMA reads served by each level"),
+      ADD_STAT(dmaMerged, "DMA reads merged into another read to the same line"),
+      ADD_STAT(dmaBrokenDown, "DMA read misses whose latency is broken down by the protocol"),
+      ADD_STAT(dmaIssueDelay, "Total cycles of the DMA read misses before leaving the L1"),
+      ADD_STAT(dmaForwardDelay, "Total cycles of the DMA read misses before being forwarded"),
+      ADD_STAT(dmaResponseDelay, "Total cycles of the DMA read misses before the first response"),
+      ADD_STAT(dmaLatencyLog2, "DMA read responses by the log2 bucket of their cycles"),
+      ADD_STAT(dmaLatencyP50, "Median cycles of the DMA read responses, by the log2 bucket"),
+      ADD_STAT(dmaLatencyP90, "90th percentile cycles of the DMA read responses, by the log2 bucket"),
+      ADD_STAT(dmaLatencyP99, "99th percentile cycles of the DMA read responses, by the log2 bucket"),
+      ADD_STAT(portLatencyP99, "99th percentile cycles of the DMA read responses of each input port"),
+      ADD_STAT(timelineSamples, "Samples of the timeline"),
+      ADD_STAT(outstandingReads, "DMA reads outstanding, summed over the samples"),
+      ADD_STAT(outstandingReadsLog2, "Samples by the log2 bucket of the DMA reads outstanding"),
+      ADD_STAT(portOccupancy, "Bytes buffered in each input port, summed over the samples"),
+      ADD_STAT(pipeline, "Cycles of each pipeline status"),
+      ADD_STAT(readRequests, "Read requests of each memory unit"),
+      ADD_STAT(readBytes, "Bytes read from each memory unit"),
+      ADD_STAT(writeRequests, "Write requests of each memory unit"),
+      ADD_STAT(writeBytes, "Bytes written to each memory unit"),
+      ADD_STAT(streamVolume, "Stream volume of each access pattern"),
+      ADD_STAT(bwRequests, "Transfers from each source to each destination"),
+      ADD_STAT(bwBytes, "Bytes from each source to each destination"),
+      ADD_STAT(avgMemoryLatency, "Average cycles of the DMA read responses"),
+      ADD_STAT(ipc, "DFG instructions per cycle"),
+      ADD_STAT(prefetchAccuracy, "Fraction of the stream prefetches demanded"),
+      ADD_STAT(avgPrefetchLead, "Average cycles from the useful prefetches to their demands"),
+      ADD_STAT(avgPrefetchCoveredLatency, "Average cycles of the DMA read responses prefetched"),
+      ADD_STAT(avgDmaServiceLatency, "Average cycles of the DMA reads served by each level"),
+      ADD_STAT(avgOutstandingReads, "Average DMA reads outstanding in the samples"),
+      ADD_STAT(avgPortOccupancy, "Average bytes buffered in each input port in the samples"),
+      lane(lane), portLatencyBase(lane.statistics.port_latency) {
+  auto &s = lane.statistics;
+  auto *l = &lane;
+
+  track([&s] () { return s.commands_issued; }, [this] (double x) { commandsIssued = x; });
+  track([l] () { return l->_stat_comp_instances; }, [this] (double x) { instances = x; });
+  track([&s] () { return s.dynamic_instructions; }, [this] (double x) { dynamicInsts = x; });
+  track([l] () { return l->_stat_cgra_busy_cycles; }, [this] (double x) { cgraBusyCycles = x; });
+  track([l] () { return l->_stat_scratch_reads; }, [this] (double x) { scratchReads = x; });
+  track([l] () { return l->_stat_scratch_writes; }, [this] (double x) { scratchWrites = x; });
+  track([l] () { return l->_stat_scratch_read_bytes; },
+        [this] (double x) { scratchReadBytes = x; });
+  track([l] () { return l->_stat_scratch_write_bytes; },
+        [this] (double x) { scratchWriteBytes = x; });
+  track([&s] () { return s.write_unit_bubble; }, [this] (double x) { writeUnitBubbles = x; });
+  track([l] () { return l->_stat_gather_elements; }, [this] (double x) { gatherElements = x; });
+  track([l] () { return l->_stat_gather_lines; }, [this] (double x) { gatherLines = x; });
+  track([l] () { return l->_stat_prefetch_issued; }, [this] (double x) { prefetchIssued = x; });
+  track([l] () { return l->_stat_prefetch_useful; }, [this] (double x) { prefetchUseful = x; });
+  track([l] () { return l->_stat_prefetch_lead_cycles; },
+        [this] (double x) { prefetchLeadCycles = x; });
+  track([l] () { return l->_stat_prefetch_covered_latency; },
+        [this] (double x) { prefetchCoveredLatency = x; });
+  // The latencies are counted in ticks.
+  track([&s, l] () { return (double) s.memory_latency / l->freq(); },
+        [this] (double x) { memoryLatency = x; });
+
+  int n = sizeof(LSQ_STATE_NAME) / sizeof(LSQ_STATE_NAME[0]);
+  memoryLatencyBreakdown.init(n);
+  for (int i = 0; i < n; ++i) {
+    memoryLatencyBreakdown.subname(i, LSQ_STATE_NAME[i]);
+    track([&s, l, i] () { return (double) s.mem_lat_brkd[i] / l->freq(); },
+          [this, i] (double x) { memoryLatencyBreakdown[i] = x; });
+  }
+
+  blame.init(Accelerator::UNKNOWN + 1).flags(Stats::total | Stats::pdf);
+  for (int i = 0; i <= Accelerator::UNKNOWN; ++i) {
+    blame.subname(i, Accelerator::BlameStr[i]);
+    track([&s, i] () { return s.blame_count[i]; }, [this, i] (double x) { blame[i] = x; });
+  }
+
+  dispatchBlocked.init(Accelerator::NUM_DISPATCH_BLOCKS).flags(Stats::total);
+  for (int i = 0; i < Accelerator::NUM_DISPATCH_BLOCKS; ++i) {
+    dispatchBlocked.subname(i, Accelerator::DispatchBlockStr[i]);
+    track([&s, i] () { return s.dispatch_blocked[i]; },
+          [this, i] (double x) { dispatchBlocked[i] = x; });
+  }
+
+  auto &service = s.service[LOC::DMA];
+  for (auto *vec : {&dmaServiceRequests, &dmaServiceLatency}) {
+    vec->init(Accelerator::NUM_SERVICE_LEVELS).flags(Stats::total | Stats::nozero);
+    for (int i = 0; i < Accelerator::NUM_SERVICE_LEVELS; ++i) {
+      vec->subname(i, Accelerator::ServiceLevelStr[i]);
+    }
+  }
+  for (int i = 0; i < Accelerator::NUM_SERVICE_LEVELS; ++i) {
+    track([&service, i] () { return service.requests[i]; },
+          [this, i] (double x) { dmaServiceRequests[i] = x; });
+    track([&service, i] () { return service.latency[i]; },
+          [this, i] (double x) { dmaServiceLatency[i] = x; });
+  }
+  track([&service] () { return service.merged; }, [this] (double x) { dmaMerged = x; });
+  track([&service] () { return service.broken_down; }, [this] (double x) { dmaBrokenDown = x; });
+  track([&service] () { return service.issue_delay; }, [this] (double x) { dmaIssueDelay = x; });
+  track([&service] () { return service.forward_delay; },
+        [this] (double x) { dmaForwardDelay = x; });
+  track([&service] () { return service.response_delay; },
+        [this] (double x) { dmaResponseDelay = x; });
+
+  // The buckets are named by their largest value.
+  for (auto *vec : {&dmaLatencyLog2, &outstandingReadsLog2}) {
+    vec->init(Log2Histogram::NUM_BUCKETS).flags(Stats::total | Stats::nozero);
+    for (int i = 0; i < Log2Histogram::NUM_BUCKETS; ++i) {
+      vec->subname(i, std::to_string(Log2Histogram::bucketMax(i)));
+    }
+  }
+  for (int i = 0; i < Log2Histogram::NUM_BUCKETS; ++i) {
+    track([&s, i] () { return s.latency_histo.buckets[i]; },
+          [this, i] (double x) { dmaLatencyLog2[i] = x; });
+    track([&s, i] () { return s.outstanding_reads.buckets[i]; },
+          [this, i] (double x) { outstandingReadsLog2[i] = x; });
+  }
+  track([&s] () { return s.outstanding_reads.count; }, [this] (double x) { timelineSamples = x; });
+  track([&s] () { return s.outstanding_reads.sum; }, [this] (double x) { outstandingReads = x; });
+
+  int num_ports = lane.input_ports.size();
+  portLatencyP99.init(num_ports).flags(Stats::nozero);
+  portOccupancy.init(num_ports).flags(Stats::nozero);
+  for (int i = 0; i < num_ports; ++i) {
+    track([&s, i] () { return i < (int) s.port_occupancy.size() ? s.port_occupancy[i] : 0; },
+          [this, i] (double x) { portOccupancy[i] = x; });
+  }
+
+  pipeline.init(pipeline_stats_t::LAST).flags(Stats::total);
+  for (int i = 0; i < pipeline_stats_t::LAST; ++i) {
+    pipeline.subname(i, pipeline_stats_t::name_of((pipeline_stats_t::PIPE_STATUS) i));
+    track([l, i] () { return l->_pipe_stats.pipe_stats[i]; },
+          [this, i] (double x) { pipeline[i] = x; });
+  }
+
+  // traffic[0] is written, and traffic[1] is read.
+  Stats::Vector *traffic[2][2] = {{&writeRequests, &writeBytes}, {&readRequests, &readBytes}};
+  for (int is_input = 0; is_input < 2; ++is_input) {
+    for (auto *vec : traffic[is_input]) {
+      vec->init(LOC::TOTAL).flags(Stats::nozero);
+      for (int i = 0; i < LOC::TOTAL; ++i) {
+        vec->subname(i, LOC_NAME[i]);
+      }
+    }
+    for (int i = 0; i < LOC::TOTAL; ++i) {
+      auto &elem = s.traffic[is_input][i];
+      auto *requests = traffic[is_input][0];
+      auto *bytes = traffic[is_input][1];
+      track([&elem] () { return elem.num_requests; },
+            [requests, i] (double x) { (*requests)[i] = x; });
+      track([&elem] () { return elem.traffic; }, [bytes, i] (double x) { (*bytes)[i] = x; });
+    }
+  }
+
+  streamVolume.init((int) STR_PAT::LEN).flags(Stats::total | Stats::nozero);
+  for (int i = 0; i < (int) STR_PAT::LEN; ++i) {
+    streamVolume.subname(i, STREAM_PATTERN_NAME[i]);
+    track([l, i] () { return l->_stream_stats.vol_histo.vol_by_type[i]; },
+          [this, i] (double x) { streamVolume[i] = x; });
+  }
+
+  // LOC::TOTAL stands for the sum of all the sources, or all the destinations.
+  for (auto *bw : {&bwRequests, &bwBytes}) {
+    bw->init(LOC::TOTAL + 1, LOC::TOTAL + 1).flags(Stats::nozero);
+    for (int i = 0; i <= LOC::TOTAL; ++i) {
+      bw->subname(i, LOC_NAME[i]);
+      bw->ysubname(i, LOC_NAME[i]);
+    }
+  }
+  for (int i = 0; i <= LOC::TOTAL; ++i) {
+    for (int j = 0; j <= LOC::TOTAL; ++j) {
+      auto key = std::make_pair((LOC) i, (LOC) j);
+      auto counter = [l, key] (bool bytes) {
+        auto iter = l->_bw_map.find(key);
+        if (iter == l->_bw_map.end()) {
+          return 0.0;
+        }
+        return (double) (bytes ? iter->second.second : iter->second.first);
+      };
+      track([counter] () { return counter(false); },
+            [this, i, j] (double x) { bwRequests[i][j] = x; });
+      track([counter] () { return counter(true); },
+            [this, i, j] (double x) { bwBytes[i][j] = x; });
+    }
+  }
+
+  avgMemoryLatency = memoryLatency / readRequests[LOC::DMA];
+  // Each cycle in the ROI is blamed on exactly one reason.
+  ipc = dynamicInsts / Stats::sum(blame);
+  prefetchAccuracy = prefetchUseful / prefetchIssued;
+  avgPrefetchLead = prefetchLeadCycles / prefetchUseful;
+  avgPrefetchCoveredLatency = prefetchCoveredLatency / prefetchUseful;
+  avgDmaServiceLatency = dmaServiceLatency / dmaServiceRequests;
+  avgOutstandingReads = outstandingReads / timelineSamples;
+  avgPortOccupancy = portOccupancy / timelineSamples;
+}
+
+void LaneStats::resetStats() {
+  Mirror::resetStats();
+  portLatencyBase = lane.statistics.port_latency;
+}
+
+void LaneStats::preDumpStats() {
+  Mirror::preDumpStats();
+  // The percentiles are not counters, so they are derived from the buckets since the reset.
+  Stats::VResult buckets;
+  dmaLatencyLog2.result(buckets);
+  dmaLatencyP50 = Log2Histogram::percentile(buckets.data(), buckets.size(), 0.5);
+  dmaLatencyP90 = Log2Histogram::percentile(buckets.data(), buckets.size(), 0.9);
+  dmaLatencyP99 = Log2Histogram::percentile(buckets.data(), buckets.size(), 0.99);
+  for (auto &elem : lane.statistics.port_latency) {
+    if (elem.first < 0 || elem.first >= (int) portLatencyP99.size()) {
+      continue;
+    }
+    double delta[Log2Histogram::NUM_BUCKETS];
+    auto &base = portLatencyBase[elem.first];
+    for (int i = 0; i < Log2Histogram::NUM_BUCKETS; ++i) {
+      delta[i] = elem.second.buckets[i] - base.buckets[i];
+    }
+    portLatencyP99[elem.first] = Log2Histogram::percentile(delta, Log2Histogram::NUM_BUCKETS, 0.99);
+  }
+}
+
+HostStats::HostStats(Stats::Group *parent, ssim_t &ssim)
+    : Mirror(parent, "dsa"),
+      ADD_STAT(instsIssued, "Host instructions issued in the ROI"),
+      ADD_STAT(instsDiscarded, "Host instructions discarded in the ROI"),
+      ADD_STAT(ctrlInstructions, "Host instructions controlling the accelerator"),
+      ADD_STAT(ctrlIntrinsics, "Accelerator intrinsics issued by the host") {
+  auto &s = ssim.statistics;
+  track([&s] () { return s.insts_issued; }, [this] (double x) { instsIssued = x; });
+  track([&s] () { return s.insts_discarded; }, [this] (double x) { instsDiscarded = x; });
+  track([&s] () { return s.ctrl_instructions; }, [this] (double x) { ctrlInstructions = x; });
+  track([&s] () { return s.ctrl_intrinsics; }, [this] (double x) { ctrlIntrinsics = x; });
+  for (int i = 0; i < (int) ssim.lanes.size(); ++i) {
+    auto name = "lane" + std::to_string(i);
+    lanes.emplace_back(new LaneStats(this, name.c_str(), *ssim.lanes[i]));
+  }
+}
+
+}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/stats/group.hh"
+
+#include "./statistics.h"
+
+class ssim_t;
+class accel_t;
+
+namespace dsa {
+namespace stat {
+
+/*!
+ * \brief Mirror the counters of the simulator to gem5 statistics, so that they are reset,
+ *        dumped, and written along with the rest of the system. The counters are kept
+ *        intact for the report of the simulator: each statistic is its counter minus the
+ *        value at the last reset, refreshed before each dump.
+ */
+struct Mirror : Stats::Group {
+  Mirror(Stats::Group *parent, const char *name) : Stats::Group(parent, name) {}
+
+  void resetStats() override;
+  void preDumpStats() override;
+
+ protected:
+  /*!
+   * \brief Mirror a counter to a statistic.
+   * \param counter Read the counter of the simulator.
+   * \param stat Write the statistic.
+   */
+  void track(std::function<double()> counter, std::function<void(double)> stat);
+
+ private:
+  struct Entry {
+    std::function<double()> counter;
+    std::function<void(double)> stat;
+    /*! \brief The value of the counter at the last reset. */
+    double base;
+  };
+  std::vector<Entry> entries;
+};
+
+/*!
+ * \brief The statistics of an accelerator lane.
+ */
+struct LaneStats : Mirror {
+  LaneStats(Stats::Group *parent, const char *name, accel_t &lane);
+
+  void resetStats() override;
+  void preDumpStats() override;
+
+  Stats::Scalar commandsIssued;
+  Stats::Scalar instances;
+  Stats::Scalar dynamicInsts;
+  Stats::Scalar cgraBusyCycles;
+  Stats::Scalar scratchReads;
+  Stats::Scalar scratchWrites;
+  Stats::Scalar scratchReadBytes;
+  Stats::Scalar scratchWriteBytes;
+  Stats::Scalar writeUnitBubbles;
+  Stats::Scalar gatherElements;
+  Stats::Scalar gatherLines;
+  Stats::Scalar prefetchIssued;
+  Stats::Scalar prefetchUseful;
+  Stats::Scalar prefetchLeadCycles;
+  Stats::Scalar prefetchCoveredLatency;
+  Stats::Scalar memoryLatency;
+  Stats::Vector memoryLatencyBreakdown;
+  Stats::Vector blame;
+  Stats::Vector dispatchBlocked;
+  Stats::Vector dmaServiceRequests;
+  Stats::Vector dmaServiceLatency;
+  Stats::Scalar dmaMerged;
+  Stats::Scalar dmaBrokenDown;
+  Stats::Scalar dmaIssueDelay;
+  Stats::Scalar dmaForwardDelay;
+  Stats::Scalar dmaResponseDelay;
+  Stats::Vector dmaLatencyLog2;
+  Stats::Scalar dmaLatencyP50;
+  Stats::Scalar dmaLatencyP90;
+  Stats::Scalar dmaLatencyP99;
+  Stats::Vector portLatencyP99;
+  Stats::Scalar timelineSamples;
+  Stats::Scalar outstandingReads;
+  Stats::Vector outstandingReadsLog2;
+  Stats::Vector portOccupancy;
+  Stats::Vector pipeline;
+  Stats::Vector readRequests;
+  Stats::Vector readBytes;
+  Stats::Vector writeRequests;
+  Stats::Vector writeBytes;
+  Stats::Vector streamVolume;
+  Stats::Vector2d bwRequests;
+  Stats::Vector2d bwBytes;
+  Stats::Formula avgMemoryLatency;
+  Stats::Formula ipc;
+  Stats::Formula prefetchAccuracy;
+  Stats::Formula avgPrefetchLead;
+  Stats::Formula avgPrefetchCoveredLatency;
+  Stats::Formula avgDmaServiceLatency;
+  Stats::Formula avgOutstandingReads;
+  Stats::Formula avgPortOccupancy;
+
+ private:
+  accel_t &lane;
+  /*!
+   * \brief The latency of each port at the last reset, for the percentiles since then.
+   */
+  std::unordered_map<int, Log2Histogram> portLatencyBase;
+};
+
+/*!
+ * \brief The statistics of the host controller, with the lanes as the subgroups.
+ */
+struct HostStats : Mirror {
+  HostStats(Stats::Group *parent, ssim_t &ssim);
+
+  Stats::Scalar instsIssued;
+  Stats::Scalar instsDiscarded;
+  Stats::Scalar ctrlInstructions;
+  Stats::Scalar ctrlIntrinsics;
+
+  std::vector<std::unique_ptr<LaneStats>> lanes;
+};
+
+}
+}
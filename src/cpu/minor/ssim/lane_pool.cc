@@ -0,0 +1,53 @@
+#include "dsa/debug.h"
+
+#include "./lane_pool.h"
+
+namespace dsa {
+namespace sim {
+
+LanePool::LanePool(int num_threads) : start(num_threads), finish(num_threads) {
+  DSA_CHECK(num_threads > 1) << "No need of a pool for " << num_threads << " thread(s)";
+  workers.reserve(num_threads - 1);
+  for (int i = 1; i < num_threads; ++i) {
+    workers.emplace_back(&LanePool::Loop, this);
+  }
+}
+
+LanePool::~LanePool() {
+  stop = true;
+  start.wait();
+  for (auto &elem : workers) {
+    elem.join();
+  }
+}
+
+void LanePool::Run(int n_, const std::function<void(int)> &task_) {
+  task = &task_;
+  n = n_;
+  next = 0;
+  start.wait();
+  Work();
+  finish.wait();
+  task = nullptr;
+  ++batches;
+}
+
+void LanePool::Work() {
+  for (int i = next++; i < n; i = next++) {
+    (*task)(i);
+  }
+}
+
+void LanePool::Loop() {
+  while (true) {
+    start.wait();
+    if (stop) {
+      return;
+    }
+    Work();
+    finish.wait();
+  }
+}
+
+}
+}
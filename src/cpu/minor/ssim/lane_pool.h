@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "base/barrier.hh"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief The worker threads that run the lane-private part of a cycle in parallel.
+ *        The caller thread works as one of the workers, and all of them meet at
+ *        a barrier before and after each batch of tasks.
+ */
+struct LanePool {
+  /*!
+   * \param num_threads The number of threads to run the tasks, including the caller.
+   */
+  LanePool(int num_threads);
+
+  ~LanePool();
+
+  /*!
+   * \brief Run the tasks 0, 1, ..., n - 1, and return when all of them are done.
+   *        The tasks should not touch the state shared among each other.
+   */
+  void Run(int n, const std::function<void(int)> &task);
+
+  /*!
+   * \brief The number of batches run in parallel.
+   */
+  int64_t batches{0};
+
+ private:
+  /*!
+   * \brief Take tasks until all of them are taken.
+   */
+  void Work();
+  /*!
+   * \brief The loop of the spawned threads.
+   */
+  void Loop();
+
+  std::vector<std::thread> workers;
+  Barrier start;
+  Barrier finish;
+  /*!
+   * \brief The batch being run, only written by the caller between the barriers.
+   */
+  const std::function<void(int)> *task{nullptr};
+  int n{0};
+  std::atomic<int> next{0};
+  bool stop{false};
+};
+
+}
+}
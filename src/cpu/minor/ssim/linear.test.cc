@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "./linear_stream.h"
+
+using dsa::sim::ByteMask;
+using dsa::sim::stream::Linear1D;
+
+namespace {
+
+/*! \brief The line walked element by element, as Linear1D::cacheline did without a buffet. */
+struct WalkedLine {
+  int64_t linebase;
+  ByteMask mask;
+  int64_t shrink;
+};
+
+WalkedLine walk(Linear1D &ls, int bandwidth, int at_most, MemoryOperation mo, LOC loc) {
+  int64_t head = ls.poll(false);
+  WalkedLine res{~(bandwidth - 1) & head, ByteMask(bandwidth), -1};
+  int64_t cnt = 0;
+  int64_t current = -1;
+  int64_t prev = -1;
+  while (cnt < at_most && ls.hasNext()) {
+    prev = current;
+    res.shrink = current = ls.poll(false);
+    if (current >= res.linebase + bandwidth) {
+      break;
+    }
+    if (mo != DMO_Read && loc == LOC::DMA && (prev != -1 && current - prev != ls.word)) {
+      break;
+    }
+    for (int j = 0; j < ls.word; ++j) {
+      res.mask.set(current - res.linebase + j);
+      ++cnt;
+    }
+    ls.poll(true);
+  }
+  res.shrink += ls.word;
+  return res;
+}
+
+}
+
+/*!
+ * \brief The elements of an affine line are counted in closed form, which should agree
+ *        with the per-element walk it replaced over random streams.
+ */
+TEST(LinearStreamTest, CachelineMatchesWalk)
+{
+  std::mt19937_64 rng(20211017);
+  auto uniform = [&rng](int64_t l, int64_t r) {
+    return std::uniform_int_distribution<int64_t>(l, r)(rng);
+  };
+
+  for (int k = 0; k < 20000 && !HasFailure(); ++k) {
+    int bandwidth = 1 << uniform(3, 7);
+    int64_t word = 1 << uniform(0, 3);
+    if (word > bandwidth) {
+      word = bandwidth;
+    }
+    // Mostly short strides, where several elements share a line.
+    int64_t stride = uniform(0, 3) ? uniform(0, 4) : uniform(0, 2 * bandwidth / word);
+    int64_t start = uniform(0, 4096 / word) * word;
+    int64_t length = uniform(1, 64);
+    auto mo = uniform(0, 1) ? DMO_Read : DMO_Write;
+    auto loc = uniform(0, 1) ? LOC::DMA : LOC::SCR;
+    Linear1D ls(word, start, stride, length, true);
+
+    while (ls.hasNext()) {
+      int at_most = uniform(0, 3) ? uniform(1, 2 * bandwidth) : bandwidth;
+      Linear1D ref(ls);
+      std::ostringstream oss;
+      oss << ls.toString() << " bandwidth:" << bandwidth << " at_most:" << at_most
+          << " mo:" << mo << " loc:" << LOC_NAME[loc];
+      SCOPED_TRACE(oss.str());
+      auto line = ls.cacheline(bandwidth, at_most, nullptr, mo, loc);
+      auto expected = walk(ref, bandwidth, at_most, mo, loc);
+      EXPECT_EQ(line.linebase, expected.linebase);
+      EXPECT_EQ(line.mask.toString(), expected.mask.toString());
+      EXPECT_EQ(line.shrink, expected.shrink);
+      EXPECT_EQ(line.as.stream_last, !ref.hasNext());
+      ASSERT_EQ(ls.i, ref.i);
+    }
+  }
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "dsa/debug.h"
+
+#include "./buffet.h"
+#include "./linear_stream.h"
+
+namespace dsa {
+namespace sim {
+namespace stream {
+
+int LinearStream::LineInfo::bytes_read() const {
+  return mask.count();
+}
+
+LinearStream::LineInfo Linear1D::cacheline(int bandwidth, int at_most, BuffetEntry *be,
+                                           MemoryOperation mo, LOC loc) {
+  DSA_CHECK(hasNext());
+  AffineStatus as;
+  as.stream_1st = i == 0;
+  as.dim_1st = i == 0 ? 1 : 0;
+  ByteMask mask(bandwidth);
+  DSA_CHECK(bandwidth == (bandwidth & -bandwidth));
+  int64_t head = poll(false);
+  if (be) {
+    head = be->Translate(head, mo);
+  }
+  int64_t base = ~(bandwidth - 1) & head;
+  DSA_LOG(LI) << "Head: " << head << ", Base: " << base;
+  int64_t untranslated = -1;
+  if (!be && word > 0 && stride >= 0) {
+    // Without a buffet, the addresses are affine, so the elements falling in this line
+    // can be counted arithmetically instead of walking them one by one below.
+    int64_t bytes = stride * word;
+    int64_t offset = head - base;
+    // Elements are taken while fewer than at_most bytes are taken.
+    int64_t n = std::min(length - i, at_most <= 0 ? 0 : (at_most + word - 1) / word);
+    int64_t fit = n;
+    if (bytes) {
+      fit = std::min(fit, (bandwidth - offset + bytes - 1) / bytes);
+    }
+    if (mo != DMO_Read && loc == LOC::DMA && bytes != word) {
+      DSA_LOG(LI) << "Incontinuous write, at most one element!";
+      fit = std::min<int64_t>(fit, 1);
+    }
+    if (fit) {
+      int64_t last = offset + (fit - 1) * bytes;
+      DSA_CHECK(last + word <= bandwidth)
+        << last << " + " << word << " not in [0, " << bandwidth << ")";
+      if (bytes <= word) {
+        mask.fill(offset, last + word);
+      } else {
+        for (int64_t j = offset; j <= last; j += bytes) {
+          mask.fill(j, j + word);
+        }
+      }
+      // The element breaking the line is also peeked.
+      untranslated = head + (fit < n ? fit : fit - 1) * bytes;
+      i += fit;
+    }
+    DSA_LOG(LI) << fit << " element(s) in [" << head << ", " << head + fit * bytes << ")";
+  } else {
+    int64_t cnt = 0;
+    int64_t current = -1;
+    int64_t prev = -1;
+    while (cnt < at_most && hasNext()) {
+      prev = current;
+      untranslated = current = poll(false);
+      if (be && !be->EnforceReadWrite(current, word)) {
+        DSA_LOG(LI) << "Cannot write to buffet!";
+        break;
+      }
+      if (be) {
+        current = be->Translate(current, mo);
+        prev = current;
+      }
+      DSA_CHECK(current >= base);
+      if (current < base + bandwidth) {
+        DSA_LOG(LI) << "Address: " << current << " x " << word;
+        if (mo != DMO_Read && loc == LOC::DMA && (prev != -1 && current - prev != word)) {
+          DSA_LOG(LI) << "Break by incontinuous write!";
+          break;
+        }
+        if (be) {
+          if (be->mo == DMO_Write) {
+            // Commit buffet append here.
+            be->Append(word);
+          }
+        }
+        for (int j = 0, n = abs(word); j < n; ++j) {
+          DSA_CHECK(current - base + j >= 0 && current - base + j < mask.size())
+            << current << " - " << base << " + " << j << " = "
+            << current - base + j << " not in [0, " << mask.size() << ")";
+          mask.set((current - base) + j);
+          ++cnt;
+        }
+        poll(true); // pop the current one
+      } else {
+        DSA_LOG(LI) << "Break by bandwidth: " << current << " >= " << base << " + " << bandwidth;
+        break;
+      }
+    }
+  }
+  DSA_LOG(SHRINK) << "shrink: " << untranslated + word;
+  as.dim_last = i == length ? 1 : 0;
+  as.n = length * word;
+  as.stream_last = !hasNext();
+  return LineInfo(base, head, std::move(mask), untranslated + word, as);
+}
+
+uint8_t AffineStatus::toTag(bool packet_1st, bool packet_last) const {
+  int res = 0;
+  int mask_1st = (1 << dim_1st) - 1;
+  int mask_last = (1 << dim_last) - 1;
+  res = (res << 1) | (((mask_last & 2) >> 1) && packet_last); // L2D end, MSB
+  res = (res << 1) | (((mask_1st & 2) >> 1) && packet_1st);   // L2D 1st
+  res = (res << 1) | ((mask_last & 1) && packet_last);        // L1D end
+  res = (res << 1) | ((mask_1st & 1) && packet_1st);          // L1D 1st
+  res = (res << 1) | (stream_last && packet_last);            // Stream end
+  res = (res << 1) | (stream_1st && packet_1st);              // Stream 1st, LSB
+  DSA_LOG(TAG) << res;
+  return res;
+}
+
+std::string AffineStatus::toString() const {
+  std::ostringstream oss;
+  oss
+    << "dim 1st: " << dim_1st << ", dim last: " << dim_last
+    << ", stream 1st: " << stream_1st << ", stream last: " << stream_last
+    << ", bytes: " << n;
+  return oss.str();
+}
+
+} // namespace stream
+} // namespace sim
+} // namespace dsa
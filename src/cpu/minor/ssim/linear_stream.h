@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <cassert>
+#include <utility>
 #include <vector>
 #include <sstream>
 #include <iostream>
@@ -10,6 +11,7 @@
 #include "dsa-ext/spec.h"
 #include "dsa-ext/rf.h"
 
+#include "./byte_mask.h"
 #include "./loc.hh"
 
 struct BuffetEntry;
@@ -88,7 +90,7 @@ struct LinearStream {
     /*!
      * \brief The bitmask predicate of this cacheline operation.
      */
-    std::vector<bool> mask;
+    ByteMask mask;
     /*!
      * \brief If we want to shrink buffet after using this response.
      */
@@ -98,11 +100,11 @@ struct LinearStream {
      */
     AffineStatus as;
 
-    LineInfo(int64_t linebase_, int64_t start_, const std::vector<bool> &mask_,
+    LineInfo(int64_t linebase_, int64_t start_, ByteMask mask_,
              int64_t shrink_, const AffineStatus &as_) :
-      linebase(linebase_), start(start_), mask(mask_), shrink(shrink_), as(as_) {}
+      linebase(linebase_), start(start_), mask(std::move(mask_)), shrink(shrink_), as(as_) {}
 
-    LineInfo(int64_t linebase_, int64_t start_, const std::vector<bool> &mask_,
+    LineInfo(int64_t linebase_, int64_t start_, const ByteMask &mask_,
              int64_t shrink_) :
       linebase(linebase_), start(start_), mask(mask_), shrink(shrink_) {}
 
@@ -148,6 +150,11 @@ struct LinearStream {
    */
   virtual int dimension() = 0;
 
+  /*!
+   * \brief A copy of this stream at its current progress, which can be run ahead.
+   */
+  virtual LinearStream *clone() const = 0;
+
   /*!
    * \brief The total bytes of data read by this stream.
    */
@@ -241,6 +248,10 @@ struct Linear1D : LinearStream {
     return word;
   }
 
+  LinearStream *clone() const override {
+    return new Linear1D(*this);
+  }
+
   int64_t word;
   int64_t start;
   int64_t stride;
@@ -319,6 +330,10 @@ struct Linear2D : LinearStream {
     return init.word_bytes();
   }
 
+  LinearStream *clone() const override {
+    return new Linear2D(*this);
+  }
+
   int64_t stretch;
   int64_t stride;
   int64_t length;
@@ -412,6 +427,10 @@ struct Linear3D : LinearStream {
     return init.word_bytes();
   }
 
+  LinearStream *clone() const override {
+    return new Linear3D(*this);
+  }
+
   /*!
    * \brief The number of dimensions.
    */
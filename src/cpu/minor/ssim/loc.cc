@@ -0,0 +1,7 @@
+#include "./loc.hh"
+
+const char *LOC_NAME[] = {
+#define MACRO(x) #x
+#include "loc.def"
+#undef MACRO
+};
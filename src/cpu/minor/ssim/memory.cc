@@ -0,0 +1,118 @@
+#include "./memory.h"
+#include "./req_pool.h"
+
+#include "dsa/debug.h"
+
+namespace dsa {
+namespace sim {
+
+bool LSQMemory::canRequest() {
+  return lsq->canRequest();
+}
+
+bool LSQMemory::transferAvailable(int port) {
+  return lsq->sd_transfers[port].unreservedRemainingSpace();
+}
+
+void LSQMemory::reserveTransfer(int port) {
+  lsq->sd_transfers[port].reserve();
+}
+
+void LSQMemory::pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                            int size, uint64_t addr, SSMemReqInfo *sdInfo) {
+  // The hints are issued as software prefetches, which the caches respond at once.
+  Request::Flags flags = sdInfo && sdInfo->prefetch ? Request::PREFETCH : 0;
+  lsq->pushRequest(inst, isLoad, data, size, addr, flags, /*res*/0, /*atomic op*/nullptr,
+                   /*byte enable*/std::vector<bool>(), sdInfo);
+}
+
+const MemoryResponse *LSQMemory::findResponse(int port) {
+  Minor::LSQ::LSQRequestPtr response = lsq->findResponse(port);
+  if (!response) {
+    return nullptr;
+  }
+  PacketPtr packet = response->packet;
+  found.sdInfo = response->sdInfo;
+  found.addr = packet->getAddr();
+  found.size = packet->getSize();
+  found.data = packet->getPtr<uint8_t>();
+  found.service = packet->req->getServiceInfo();
+  return &found;
+}
+
+void LSQMemory::popResponse(int port) {
+  lsq->popResponse(port);
+}
+
+bool LSQMemory::is_pending_net_empty() {
+  return lsq->is_pending_net_empty();
+}
+
+bool LSQMemory::can_push_net_req(int num_data_bytes) {
+  return lsq->can_push_net_req(num_data_bytes);
+}
+
+void LSQMemory::serve_pending_net_req() {
+  lsq->serve_pending_net_req();
+}
+
+void LSQMemory::check_cpu_response_queue() {
+  lsq->check_cpu_response_queue();
+}
+
+void LSQMemory::push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr,
+                                     int data_bytes, int reorder_entry) {
+  lsq->push_rem_read_return(dst_core, data, request_ptr, addr, data_bytes, reorder_entry);
+}
+
+void LSQMemory::print_spu_stats(int spu_id) {
+  lsq->print_spu_stats(spu_id);
+}
+
+uint64_t LSQMemory::clockPeriod() {
+  return lsq->get_cpu().clockDomain.clockPeriod();
+}
+
+int LSQMemory::getCpuId() {
+  return lsq->getCpuId();
+}
+
+void FunctionalMemory::pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                                   int size, uint64_t addr, SSMemReqInfo *sdInfo) {
+  ++requests;
+  if (!isLoad) {
+    proxy.writeBlob(addr, data, size);
+    Release(sdInfo);
+    return;
+  }
+  auto &q = queues[sdInfo->trans_idx];
+  q.emplace_back();
+  auto &entry = q.back();
+  entry.addr = addr;
+  entry.sdInfo = sdInfo;
+  entry.data.resize(size);
+  proxy.readBlob(addr, entry.data.data(), size);
+}
+
+const MemoryResponse *FunctionalMemory::findResponse(int port) {
+  auto iter = queues.find(port);
+  if (iter == queues.end() || iter->second.empty()) {
+    return nullptr;
+  }
+  auto &entry = iter->second.front();
+  found.sdInfo = entry.sdInfo;
+  found.addr = entry.addr;
+  found.size = entry.data.size();
+  found.data = entry.data.data();
+  return &found;
+}
+
+void FunctionalMemory::popResponse(int port) {
+  auto &q = queues[port];
+  DSA_CHECK(!q.empty()) << port;
+  Release(q.front().sdInfo);
+  q.pop_front();
+}
+
+}
+}
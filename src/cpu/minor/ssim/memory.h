@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "cpu/minor/lsq.hh"
+#include "mem/port_proxy.hh"
+#include "mem/request.hh"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief A response of stream-dataflow memory request, ready to be consumed.
+ */
+struct MemoryResponse {
+  /*! \brief The request info attached by the stream. */
+  SSMemReqInfo *sdInfo{nullptr};
+  /*! \brief The address of the first byte of the data. */
+  uint64_t addr{0};
+  /*! \brief The size of the data in bytes. */
+  int size{0};
+  /*! \brief The data responded. */
+  uint8_t *data{nullptr};
+  /*! \brief Where and how long the memory served the request, if it is known. */
+  Request::ServiceInfo service;
+};
+
+/*!
+ * \brief The memory system seen by the accelerator lanes. By default, it is the LSQ of the
+ *        host core, but the simulator can also be driven by a standalone memory model.
+ */
+struct MemoryInterface {
+  virtual ~MemoryInterface() {}
+
+  /*! \brief If the memory can take one more request. */
+  virtual bool canRequest() = 0;
+  /*! \brief If the transfer queue of the given port has unreserved space. */
+  virtual bool transferAvailable(int port) = 0;
+  /*! \brief Reserve a slot in the transfer queue of the given port for a read. */
+  virtual void reserveTransfer(int port) = 0;
+  /*!
+   * \brief Issue a memory request. The memory takes the ownership of the sdInfo.
+   * \param data The data to write, or null for a read.
+   */
+  virtual void pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                           int size, uint64_t addr, SSMemReqInfo *sdInfo) = 0;
+  /*!
+   * \brief The oldest response of the given port, or null if it is not ready yet.
+   *        The response is valid until it is popped.
+   */
+  virtual const MemoryResponse *findResponse(int port) = 0;
+  /*! \brief Retire the oldest response of the given port. */
+  virtual void popResponse(int port) = 0;
+
+  /*! \brief The traffic among the cores. */
+  virtual bool is_pending_net_empty() = 0;
+  /*! \brief If a message of the given bytes can be queued to the other cores now. */
+  virtual bool can_push_net_req(int num_data_bytes) = 0;
+  virtual void serve_pending_net_req() = 0;
+  virtual void check_cpu_response_queue() = 0;
+  virtual void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr,
+                                    int data_bytes, int reorder_entry) = 0;
+  virtual void print_spu_stats(int spu_id) = 0;
+
+  /*! \brief The ticks of a cycle of the host core. */
+  virtual uint64_t clockPeriod() = 0;
+  /*! \brief The ID of the host core. */
+  virtual int getCpuId() = 0;
+};
+
+/*!
+ * \brief Drive the accelerator lanes by the LSQ of the host core.
+ */
+struct LSQMemory : MemoryInterface {
+  LSQMemory(Minor::LSQ *lsq_) : lsq(lsq_) {}
+
+  bool canRequest() override;
+  bool transferAvailable(int port) override;
+  void reserveTransfer(int port) override;
+  void pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                   int size, uint64_t addr, SSMemReqInfo *sdInfo) override;
+  const MemoryResponse *findResponse(int port) override;
+  void popResponse(int port) override;
+
+  bool is_pending_net_empty() override;
+  bool can_push_net_req(int num_data_bytes) override;
+  void serve_pending_net_req() override;
+  void check_cpu_response_queue() override;
+  void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr,
+                            int data_bytes, int reorder_entry) override;
+  void print_spu_stats(int spu_id) override;
+
+  uint64_t clockPeriod() override;
+  int getCpuId() override;
+
+  Minor::LSQ *lsq;
+
+ private:
+  /*! \brief The response found last time, unpacked from the packet of the request. */
+  MemoryResponse found;
+};
+
+/*!
+ * \brief Serve the requests of the lanes at once by functional accesses, so that the
+ *        stream commands are executed without the timing of the memory system.
+ *        The traffic among the cores and the clock are still those of the timed memory.
+ */
+struct FunctionalMemory : MemoryInterface {
+  /*!
+   * \param timed The memory system replaced.
+   * \param proxy The functional accesses to the virtual address space of the host thread.
+   */
+  FunctionalMemory(MemoryInterface *timed_, PortProxy &proxy_) : timed(timed_), proxy(proxy_) {}
+
+  bool canRequest() override { return true; }
+  bool transferAvailable(int port) override { return true; }
+  void reserveTransfer(int port) override {}
+  void pushRequest(Minor::MinorDynInstPtr inst, bool isLoad, uint8_t *data,
+                   int size, uint64_t addr, SSMemReqInfo *sdInfo) override;
+  const MemoryResponse *findResponse(int port) override;
+  void popResponse(int port) override;
+
+  bool is_pending_net_empty() override { return timed->is_pending_net_empty(); }
+  bool can_push_net_req(int num_data_bytes) override {
+    return timed->can_push_net_req(num_data_bytes);
+  }
+  void serve_pending_net_req() override { timed->serve_pending_net_req(); }
+  void check_cpu_response_queue() override { timed->check_cpu_response_queue(); }
+  void push_rem_read_return(int dst_core, int8_t data[64], int request_ptr, int addr,
+                            int data_bytes, int reorder_entry) override {
+    timed->push_rem_read_return(dst_core, data, request_ptr, addr, data_bytes, reorder_entry);
+  }
+  void print_spu_stats(int spu_id) override { timed->print_spu_stats(spu_id); }
+
+  uint64_t clockPeriod() override { return timed->clockPeriod(); }
+  int getCpuId() override { return timed->getCpuId(); }
+
+  /*! \brief The memory system replaced, restored when the timed simulation begins. */
+  MemoryInterface *timed;
+  /*! \brief The requests served. */
+  int64_t requests{0};
+
+ private:
+  struct Pending {
+    uint64_t addr;
+    SSMemReqInfo *sdInfo;
+    std::vector<uint8_t> data;
+  };
+
+  PortProxy &proxy;
+  /*! \brief The data read, to be consumed by each port in order. */
+  std::unordered_map<int, std::deque<Pending>> queues;
+  MemoryResponse found;
+};
+
+}
+}
@@ -1,8 +1,11 @@
+#include <algorithm>
 #include <bitset>
+#include <cstring>
 #include "./accel.hh"
 #include "./ssim.hh"
 #include "./stream.hh"
 #include "./port.h"
+#include "./arbiter.h"
 #include "dsa/dfg/port.h"
 #include "dsa/simulation/data.h"
 
@@ -56,6 +59,10 @@ std::string PortExecState::toString() {
 void Port::bindStream(base_stream_t *s) {
   DSA_CHECK(!stream) << "Now serving stream " << s << ": " << s->toString();
   stream = s;
+  parent->arbiter->Bind(this, isInput());
+  if (auto *t = parent->tracer) {
+    t->Issue(parent->now(), parent->accel_index(), s->id(), id(), s->unit());
+  }
 }
 
 template<typename T>
@@ -83,7 +90,13 @@ void Port::freeStream() {
   PostProcessor functor;
   DSA_LOG(COMMAND) << id() << " free " << stream->toString();
   stream->Accept(&functor);
+  if (auto *t = parent->tracer) {
+    t->Retire(parent->now(), parent->accel_index(), stream->id(), id(), stream->unit());
+  }
+  parent->statistics.retireStream(stream->id());
   stream = nullptr;
+  parent->arbiter->Free(this, isInput());
+  parent->freed_ports[isInput()].push_back(id());
 }
 
 int InPort::id() const {
@@ -113,20 +126,21 @@ int OutPort::vectorLanes() const {
   return ovp()->vectorLanes();
 }
 
-void InPort::push(const std::vector<uint8_t> &raw, const stream::AffineStatus &as, bool imm) {
+template<typename F>
+void InPort::pushImpl(int bytes, F gather, const stream::AffineStatus &as, bool imm) {
   int dbytes = scalarSizeInBytes();
   int lanes = vectorLanes();
   if (!imm) {
-    ongoing -= raw.size();
-    DSA_LOG(PORT) << "Deregister " << raw.size() << " bytes for port " << id();
+    ongoing -= bytes;
+    DSA_LOG(PORT) << "Deregister " << bytes << " bytes for port " << id();
   }
   DSA_CHECK(ongoing >= 0);
   // TODO(@were): This significantly hurt the performance.
   // DSA_CHECK(canPush(true) >= raw.size())
   //   << buffer_size << " - " << ongoing << " - " << buffer.size() << " * " << scalarSizeInBytes()
   //   << " = " << canPush(true) << " < " << raw.size();
-  DSA_CHECK(raw.size() % dbytes == 0)
-    << raw.size() << " % " << dbytes << " != 0, cannot gaurantee the alignment of predicate!";
+  DSA_CHECK(bytes % dbytes == 0)
+    << bytes << " % " << dbytes << " != 0, cannot gaurantee the alignment of predicate!";
   int residue = as.n % (lanes * dbytes);
   int padCount = residue ? (lanes * dbytes) - residue : 0;
   if (as.n == -1) {
@@ -137,7 +151,7 @@ void InPort::push(const std::vector<uint8_t> &raw, const stream::AffineStatus &a
   }
 
   // TODO(@were): Make sure this is correct!
-  auto cpu_freq = parent->lsq()->get_cpu().clockDomain.clockPeriod();
+  auto cpu_freq = parent->lsq()->clockPeriod();
   auto aa = parent->now() + cpu_freq;
 #define PADDING_IMPL(cond, zero_enum, predoff_enum)                \
   do {                                                             \
@@ -154,9 +168,10 @@ void InPort::push(const std::vector<uint8_t> &raw, const stream::AffineStatus &a
 
   int from = buffer.size();
 
-  for (int i = 0; i < raw.size(); i += dbytes) {
+  for (int i = 0; i < bytes; i += dbytes) {
+    // The scalars are little-endian, as the host.
     uint64_t data = 0;
-    std::memcpy(&data, raw.data() + i, dbytes);
+    gather(reinterpret_cast<uint8_t*>(&data), dbytes);
     buffer.emplace_back(SpatialPacket(aa, data, true));
   }
   PADDING_IMPL(as.dim_last, DP_PostStrideZero, DP_PostStridePredOff);
@@ -182,6 +197,46 @@ void InPort::push(const std::vector<uint8_t> &raw, const stream::AffineStatus &a
   }
 }
 
+void InPort::push(const std::vector<uint8_t> &raw, const stream::AffineStatus &as, bool imm) {
+  const uint8_t *ptr = raw.data();
+  pushImpl(raw.size(), [&ptr] (uint8_t *dst, int n) {
+    std::memcpy(dst, ptr, n);
+    ptr += n;
+  }, as, imm);
+}
+
+void InPort::pushMasked(const uint8_t *line, const ByteMask &mask,
+                        const stream::AffineStatus &as, bool imm) {
+  int n = mask.count();
+  int first = mask.next(0);
+  // A full or contiguous mask is copied in bulk, only the holes are gathered byte by byte.
+  if (first + n == mask.size() || mask.next(first + n) == mask.size()) {
+    const uint8_t *ptr = line + first;
+    pushImpl(n, [&ptr] (uint8_t *dst, int m) {
+      std::memcpy(dst, ptr, m);
+      ptr += m;
+    }, as, imm);
+    return;
+  }
+  int i = -1;
+  pushImpl(n, [line, &mask, &i] (uint8_t *dst, int m) {
+    for (int j = 0; j < m; ++j) {
+      i = mask.next(i + 1);
+      dst[j] = line[i];
+    }
+  }, as, imm);
+}
+
+void InPort::pushMapped(const uint8_t *line, const std::vector<int> &map,
+                        const stream::AffineStatus &as, bool imm) {
+  int i = 0;
+  pushImpl(map.size(), [line, &map, &i] (uint8_t *dst, int m) {
+    for (int j = 0; j < m; ++j) {
+      dst[j] = line[map[i++]];
+    }
+  }, as, imm);
+}
+
 int InPort::canPush(bool ip) {
   int padding_buffer = ip * vectorLanes() * scalarSizeInBytes();
   return buffer_size + padding_buffer  - (ongoing + buffer.size() * scalarSizeInBytes());
@@ -211,14 +266,14 @@ void InPort::pop(bool check) {
   if (pes.tick()) {
     int n = vectorLanes();
     if (ivp()->stationary_shift == -1) {
-      buffer.erase(buffer.begin(), buffer.begin() + n);
+      buffer.pop(n);
     } else {
       // If we reach the end of stream, clear the shift state, and all the remaining data.
       if (buffer[n - 1].stream_state & 2) {
         ivp()->stationary_shift = -1;
-        buffer.erase(buffer.begin(), buffer.begin() + n);
+        buffer.pop(n);
       } else {
-        buffer.erase(buffer.begin(), buffer.begin() + ivp()->stationary_shift);
+        buffer.pop(ivp()->stationary_shift);
       }
     }
     DSA_LOG(PORT)
@@ -228,7 +283,7 @@ void InPort::pop(bool check) {
 
 void OutPort::pop(int n) {
   DSA_CHECK(raw.size() >= n);
-  raw.erase(raw.begin(), raw.begin() + n);
+  raw.pop(n);
   int ops = ovp()->penetrated_state;
   if (ops != -1) {
     state.erase(state.begin());
@@ -243,15 +298,9 @@ bool InPort::empty() {
   return buffer.empty();
 }
 
-std::vector<PortPacket> InPort::poll() {
-  int n = vectorLanes();
+RingBuffer<PortPacket>::View InPort::poll() {
   DSA_CHECK(lanesReady());
-  std::vector<PortPacket> res(buffer.begin(), buffer.begin() + n);
-  return res;
-}
-
-void OutPort::push(const std::vector<uint8_t> &data) {
-  raw.insert(raw.end(), data.begin(), data.end());
+  return buffer.view(vectorLanes());
 }
 
 int OutPort::canPop(int n) {
@@ -270,9 +319,8 @@ std::vector<uint8_t> OutPort::poll(int n) {
   std::vector<uint8_t> res;
   int ops = ovp()->penetrated_state;
   res.reserve(n + (ops != -1));
-  for (int i = 0; i < n; ++i) {
-    res.push_back(raw[i]);
-  }
+  res.resize(n, 0);
+  raw.peek(res.data(), n);
   if (ops != -1) {
     res.push_back(state[0]);
     DSA_LOG(PENE) << "Penetrate: " << (int) res.back() << " " << std::bitset<6>(res.back());
@@ -20,6 +20,7 @@
 #include "dsa/simulation/data.h"
 
 #include "./linear_stream.h"
+#include "./ring_buffer.h"
 
 
 struct base_stream_t;
@@ -154,6 +155,10 @@ struct Port {
    * \brief Data in bytes buffered in this port.
    */
   virtual int bytesBuffered() const = 0;
+  /*!
+   * \brief If this is an input port.
+   */
+  virtual bool isInput() const = 0;
   /*!
    * \brief Affine stream state buffer.
    *        Input: buffers specific state of the state machine.
@@ -187,7 +192,7 @@ struct InPort : Port {
   /*!
    * \brief The data ready to be distributed by the crossbar.
    */
-  std::deque<PortPacket> buffer;
+  RingBuffer<PortPacket> buffer;
   /*!
    * \brief The state machine of port data repeat.
    */
@@ -212,10 +217,9 @@ struct InPort : Port {
    */
   void pop(bool check = true);
   /*!
-   * \brief Get the data ready.
-   * \param n Get n elements once.
+   * \brief Get the data ready, without copying them out of the FIFO.
    */
-  std::vector<PortPacket> poll();
+  RingBuffer<PortPacket>::View poll();
   /*!
    * \brief Push raw data to the FIFO.
    * \param data The data to be pushed.
@@ -223,6 +227,24 @@ struct InPort : Port {
    * \param immediate If this pushed value is ready immediately. If not, clear ongoing.
    */
   void push(const std::vector<uint8_t> &data, const stream::AffineStatus &as, bool immediate);
+  /*!
+   * \brief Push the bytes enabled by the mask to the FIFO, without gathering them first.
+   * \param line The raw data of the cacheline.
+   * \param mask The byte mask of the cacheline.
+   * \param as The status of the stream for padding.
+   * \param immediate If this pushed value is ready immediately. If not, clear ongoing.
+   */
+  void pushMasked(const uint8_t *line, const ByteMask &mask,
+                  const stream::AffineStatus &as, bool immediate);
+  /*!
+   * \brief Push the bytes indexed by the map to the FIFO, without gathering them first.
+   * \param line The raw data of the cacheline.
+   * \param map The byte indices of the cacheline to push.
+   * \param as The status of the stream for padding.
+   * \param immediate If this pushed value is ready immediately. If not, clear ongoing.
+   */
+  void pushMapped(const uint8_t *line, const std::vector<int> &map,
+                  const stream::AffineStatus &as, bool immediate);
   /*!
    * \brief The ID of this port.
    */
@@ -251,16 +273,36 @@ struct InPort : Port {
    * \brief Data in bytes buffered in this port.
    */
   int bytesBuffered() const override;
+  /*!
+   * \brief This is an input port.
+   */
+  bool isInput() const override { return true; }
 
-  InPort(accel_t *a, int size, int id) : Port(a), pes(IVPState(), id), buffer_size(size) {}
+  /*!
+   * \param size The bytes of the FIFO. The elements are reserved as if they are all bytes,
+   *        with the same amount again for padding.
+   */
+  InPort(accel_t *a, int size, int id) :
+    Port(a), buffer(size * 2), pes(IVPState(), id), buffer_size(size) {}
+
+ private:
+  /*!
+   * \brief The implementation of pushing data.
+   * \param bytes The number of bytes to push.
+   * \param gather Copy the next n bytes to push in order to the given destination.
+   */
+  template<typename F>
+  void pushImpl(int bytes, F gather, const stream::AffineStatus &as, bool immediate);
 };
 
 struct OutPort : Port {
   int id_;
+  /*!
+   * \brief The bytes produced by the spatial architecture.
+   */
+  RingBuffer<uint8_t> raw;
 
-  std::deque<uint8_t> raw;
-
-  OutPort(accel_t *a, int size, int id_) : Port(a), id_(id_) {}
+  OutPort(accel_t *a, int size, int id_) : Port(a), id_(id_), raw(size) {}
   /*!
    * \brief The ID of this port.
    */
@@ -292,6 +334,13 @@ struct OutPort : Port {
    * \param n The given bytes to get.
    */
   std::vector<uint8_t> poll(int n);
+  /*!
+   * \brief Copy the given bytes from the FIFO to a span, without popping them.
+   *        The penetrated state is not included.
+   * \param dst The span to copy to.
+   * \param n The given bytes to copy.
+   */
+  void peek(uint8_t *dst, int n) const { raw.peek(dst, n); }
   /*!
    * \brief Pop the given bytes from the FIFO.
    * \param n The given bytes to pop.
@@ -300,8 +349,9 @@ struct OutPort : Port {
   /*!
    * \brief Push data from spatial architecture to the port FIFO buffer.
    * \param data The data in raw byte format.
+   * \param n The bytes of the data.
    */
-  void push(const std::vector<uint8_t> &data);
+  void push(const uint8_t *data, int n) { raw.push(data, n); }
   /*!
    * \brief The output port sub-class.
    */
@@ -310,6 +360,10 @@ struct OutPort : Port {
    * \brief Data in bytes buffered in this port.
    */
   int bytesBuffered() const override;
+  /*!
+   * \brief This is an output port.
+   */
+  bool isInput() const override { return false; }
 };
 
 }
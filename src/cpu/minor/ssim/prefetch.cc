@@ -0,0 +1,75 @@
+#include "./prefetch.h"
+
+#include <algorithm>
+
+#include "dsa/debug.h"
+
+namespace dsa {
+namespace sim {
+
+StreamPrefetcher::StreamPrefetcher(int line_, int distance_, int outstanding_)
+    : line(line_), distance(distance_), outstanding(outstanding_) {
+  DSA_CHECK(line > 0 && (line & (line - 1)) == 0) << line << " is not a power of 2";
+}
+
+int64_t StreamPrefetcher::Demand(int sid, const stream::LinearStream &ls, int64_t linebase,
+                                 int64_t cycle) {
+  auto &cursor = cursors[sid];
+  auto iter = std::find_if(cursor.ahead.begin(), cursor.ahead.end(),
+                           [linebase] (const Line &l) { return l.addr == linebase; });
+  if (iter == cursor.ahead.end()) {
+    // The rest of a line demanded is not looked ahead, otherwise the copy falls behind.
+    if (!cursor.ls || linebase != cursor.demanded) {
+      cursor.ls.reset(ls.clone());
+      cursor.ahead.clear();
+      cursor.last = linebase;
+    }
+    cursor.demanded = linebase;
+    return -1;
+  }
+  int64_t lead = iter->cycle == -1 ? -1 : cycle - iter->cycle;
+  cursor.ahead.erase(cursor.ahead.begin(), iter + 1);
+  cursor.demanded = linebase;
+  return lead;
+}
+
+int64_t StreamPrefetcher::Next(int sid, int64_t cycle) {
+  auto iter = cursors.find(sid);
+  if (_in_flight >= outstanding || iter == cursors.end()) {
+    return -1;
+  }
+  auto &cursor = iter->second;
+  // Bound the elements polled in a cycle, in case the stream stays in a line for long.
+  for (int polls = 0; polls < line && (int) cursor.ahead.size() < distance &&
+       cursor.ls->hasNext(); ++polls) {
+    int64_t addr = cursor.ls->poll(true) & ~((int64_t) line - 1);
+    if (addr == cursor.last) {
+      continue;
+    }
+    cursor.last = addr;
+    bool looked = std::any_of(cursor.ahead.begin(), cursor.ahead.end(),
+                              [addr] (const Line &l) { return l.addr == addr; });
+    cursor.ahead.push_back({addr, looked ? -1 : cycle});
+    if (!looked) {
+      ++_in_flight;
+      return addr;
+    }
+  }
+  return -1;
+}
+
+void StreamPrefetcher::Complete() {
+  DSA_CHECK(_in_flight > 0) << "No prefetch in flight!";
+  --_in_flight;
+}
+
+void StreamPrefetcher::Retire(int sid) {
+  cursors.erase(sid);
+}
+
+void StreamPrefetcher::Reset() {
+  cursors.clear();
+}
+
+}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+
+#include "./linear_stream.h"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief Run ahead of the affine DMA read streams, and hint the cache hierarchy of the lines
+ *        they are about to read. Each stream is followed by a copy of its generator, which
+ *        stays at most a distance of lines ahead of the demand requests. If the demand
+ *        requests are not the lines looked ahead, the copy starts over from the stream.
+ */
+struct StreamPrefetcher {
+  /*!
+   * \param line The bytes of a line.
+   * \param distance The lines looked ahead of the demand requests of each stream.
+   * \param outstanding The prefetches in flight at most.
+   */
+  StreamPrefetcher(int line, int distance, int outstanding);
+
+  /*!
+   * \brief A demand request of the stream.
+   * \param sid The ID of the stream.
+   * \param ls The generator of the stream, after the request.
+   * \param linebase The line requested.
+   * \param cycle The current cycle.
+   * \return The cycles since the line was prefetched, or -1 if it was not.
+   */
+  int64_t Demand(int sid, const stream::LinearStream &ls, int64_t linebase, int64_t cycle);
+
+  /*!
+   * \brief The next line of the stream to prefetch, which is counted in flight,
+   *        or -1 if the stream is far enough ahead, or too many prefetches are in flight.
+   */
+  int64_t Next(int sid, int64_t cycle);
+
+  /*! \brief A prefetch is responded by the memory. */
+  void Complete();
+
+  /*! \brief The stream is done. */
+  void Retire(int sid);
+
+  /*! \brief Drop all the streams. The prefetches in flight are still responded. */
+  void Reset();
+
+  /*! \brief The prefetches not responded yet. */
+  int in_flight() const { return _in_flight; }
+
+  /*! \brief The lines of the stream looked ahead but not demanded yet. */
+  int ahead(int sid) const {
+    auto iter = cursors.find(sid);
+    return iter == cursors.end() ? 0 : iter->second.ahead.size();
+  }
+
+ private:
+  struct Line {
+    int64_t addr;
+    /*! \brief The cycle the line is prefetched, or -1 if it is already looked ahead. */
+    int64_t cycle;
+  };
+
+  struct Cursor {
+    /*! \brief The copy of the generator, ahead of the stream. */
+    std::unique_ptr<stream::LinearStream> ls;
+    /*! \brief The lines looked ahead but not demanded yet, in the order of the stream. */
+    std::deque<Line> ahead;
+    /*! \brief The last line generated by the copy. */
+    int64_t last{-1};
+    /*! \brief The last line demanded by the stream. */
+    int64_t demanded{-1};
+  };
+
+  int line;
+  int distance;
+  int outstanding;
+  int _in_flight{0};
+  std::unordered_map<int, Cursor> cursors;
+};
+
+}
+}
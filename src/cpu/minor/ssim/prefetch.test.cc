@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include "./linear_stream.h"
+#include "./prefetch.h"
+
+using dsa::sim::StreamPrefetcher;
+using dsa::sim::stream::Linear1D;
+
+namespace {
+
+/*!
+ * \brief Issue the prefetches the way prefetchAhead does, until Next gives up.
+ * \return The prefetches issued.
+ */
+int prefetchAhead(StreamPrefetcher &prefetcher, int sid, int64_t cycle) {
+  int issued = 0;
+  while (prefetcher.Next(sid, cycle) != -1) {
+    ++issued;
+  }
+  return issued;
+}
+
+const int line = 64;
+const int word = 4;
+const int distance = 8;
+const int lines = 64;
+const int sid = 1;
+
+}
+
+/*!
+ * \brief A stream reading one line per request should be looked ahead by
+ *        dma_prefetch_distance lines, not just by the next one.
+ */
+TEST(StreamPrefetcherTest, LooksAheadByDistance)
+{
+  StreamPrefetcher prefetcher(line, distance, /*outstanding*/2 * distance);
+  // A contiguous stream of words, read one line per request.
+  Linear1D ls(word, 0, 1, lines * line / word, true);
+
+  int useful = 0;
+  for (int64_t cycle = 0, linebase = 0; ls.hasNext(); ++cycle, linebase += line) {
+    for (int i = 0; i < line / word; ++i) {
+      ls.poll(true);
+    }
+    if (prefetcher.Demand(sid, ls, linebase, cycle) != -1) {
+      ++useful;
+    }
+    prefetchAhead(prefetcher, sid, cycle);
+    int remaining = lines - 1 - linebase / line;
+    EXPECT_EQ(prefetcher.ahead(sid), std::min(remaining, distance)) << "line " << linebase;
+    // The memory responds all the prefetches before the next request.
+    while (prefetcher.in_flight()) {
+      prefetcher.Complete();
+    }
+  }
+  // All the lines but the first one are prefetched.
+  EXPECT_EQ(useful, lines - 1);
+}
+
+/*!
+ * \brief Without responses, the lookahead stops at the prefetches in flight.
+ */
+TEST(StreamPrefetcherTest, BoundedByOutstanding)
+{
+  StreamPrefetcher bounded(line, distance, /*outstanding*/3);
+  Linear1D bs(word, 0, 1, lines * line / word, true);
+  for (int i = 0; i < line / word; ++i) {
+    bs.poll(true);
+  }
+  bounded.Demand(sid, bs, 0, 0);
+  EXPECT_EQ(prefetchAhead(bounded, sid, 0), 3);
+}
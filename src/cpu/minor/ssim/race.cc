@@ -0,0 +1,140 @@
+#include <algorithm>
+
+#include "dsa/debug.h"
+#include "dsa-ext/rf.h"
+
+#include "./race.h"
+
+namespace dsa {
+namespace sim {
+
+namespace {
+
+const char *KIND_NAME[] = {"read", "write", "atomic"};
+
+/*!
+ * \brief The barrier flags in the mask, e.g. SPAD|Write.
+ */
+std::string FlagString(uint64_t mask) {
+  static const std::pair<int, const char*> FLAGS[] = {
+    {DBF_DMAStreams, "DMA"}, {DBF_SPadStreams, "SPAD"}, {DBF_RecurStreams, "Recur"},
+    {DBF_ReadStreams, "Read"}, {DBF_WriteStreams, "Write"}, {DBF_AtomicStreams, "Atomic"},
+    {DBF_ComputStreams, "Compute"},
+  };
+  std::string res;
+  for (auto &elem : FLAGS) {
+    if (mask >> elem.first & 1) {
+      res += res.empty() ? "" : "|";
+      res += elem.second;
+    }
+  }
+  return res;
+}
+
+}
+
+RaceDetector::RaceDetector(int bank_width_) : bank_width(bank_width_) {
+  DSA_CHECK(bank_width > 0 && bank_width <= 64)
+    << "Bank line of " << bank_width << " bytes cannot be tracked!";
+}
+
+void RaceDetector::Access(int stream, uint64_t barrier_mask, int spad, int64_t base,
+                          const ByteMask &mask, Kind kind) {
+  int64_t line = -1;
+  uint64_t bytes = 0;
+  mask.forEach([&] (int i) {
+    int64_t addr = base + i;
+    if (addr / bank_width != line) {
+      if (bytes) {
+        Touch(stream, barrier_mask, spad, line, bytes, kind);
+      }
+      line = addr / bank_width;
+      bytes = 0;
+    }
+    bytes |= 1ull << (addr % bank_width);
+  });
+  if (bytes) {
+    Touch(stream, barrier_mask, spad, line, bytes, kind);
+  }
+}
+
+void RaceDetector::Touch(int stream, uint64_t barrier_mask, int spad, int64_t line,
+                         uint64_t bytes, Kind kind) {
+  auto &records = lines[(int64_t) spad << 48 | line];
+  Record cur{stream, barrier_mask, bytes, kind};
+  Record *same = nullptr;
+  for (auto &elem : records) {
+    if (elem.stream == stream) {
+      if (elem.kind == kind) {
+        same = &elem;
+      }
+      continue;
+    }
+    if (!(elem.bytes & bytes) || (elem.kind == Read && kind == Read) ||
+        (elem.kind == Atomic && kind == Atomic)) {
+      continue;
+    }
+    if (!Ordered(elem, cur)) {
+      Report(elem, cur, spad, line);
+    }
+  }
+  if (same) {
+    same->bytes |= bytes;
+  } else {
+    records.push_back(cur);
+  }
+}
+
+bool RaceDetector::Ordered(const Record &a, const Record &b) const {
+  const Record &earlier = a.stream < b.stream ? a : b;
+  int later = std::max(a.stream, b.stream);
+  auto iter = std::upper_bound(barriers.begin(), barriers.end(), earlier.stream,
+                               [] (int id, const std::pair<int, uint64_t> &elem) {
+                                 return id < elem.first;
+                               });
+  for (; iter != barriers.end() && iter->first < later; ++iter) {
+    if (!iter->second || (iter->second & earlier.barrier_mask)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void RaceDetector::Report(const Record &a, const Record &b, int spad, int64_t line) {
+  const Record &earlier = a.stream < b.stream ? a : b;
+  const Record &later = a.stream < b.stream ? b : a;
+  if (!reported.insert(std::make_pair(earlier.stream, later.stream)).second) {
+    return;
+  }
+  ++races;
+  DSA_WARNING
+    << "Scratchpad race: stream " << earlier.stream << " (" << KIND_NAME[earlier.kind]
+    << ") and stream " << later.stream << " (" << KIND_NAME[later.kind]
+    << ") on spad " << spad << " @" << line * bank_width
+    << ", missing a barrier on " << FlagString(earlier.barrier_mask)
+    << " between them!";
+}
+
+void RaceDetector::Barrier(int id, uint64_t mask) {
+  DSA_CHECK(barriers.empty() || barriers.back().first < id) << id;
+  barriers.emplace_back(id, mask);
+  retiring.emplace_back(id, mask);
+}
+
+void RaceDetector::Drop(int id, uint64_t mask) {
+  // The streams after the barrier may be running already, so only the ones before it go.
+  for (auto iter = lines.begin(); iter != lines.end(); ) {
+    auto &records = iter->second;
+    records.erase(std::remove_if(records.begin(), records.end(), [id, mask] (const Record &elem) {
+      return elem.stream < id && (!mask || (elem.barrier_mask & mask));
+    }), records.end());
+    if (records.empty()) {
+      iter = lines.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+}
+}
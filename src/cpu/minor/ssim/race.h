@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./byte_mask.h"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief Detect the scratchpad accesses of different streams not ordered by any barrier.
+ *        Program order is given by the stream IDs, which are allocated as the commands
+ *        are issued, so the barriers split the streams into epochs. Each bank line keeps
+ *        the streams that read or wrote it, with the bytes they touched. A conflicting
+ *        pair of accesses races, if no barrier between the two streams waits for the
+ *        earlier one. When the detection is off, no detector is built,
+ *        and each hook costs a null check.
+ */
+struct RaceDetector {
+  enum Kind : uint8_t {
+    Read,
+    Write,
+    /*! \brief In-situ updates commute with each other, but not with reads and writes. */
+    Atomic,
+  };
+
+  /*!
+   * \param bank_width The bytes of a bank line, which is the granularity of tracking.
+   */
+  RaceDetector(int bank_width);
+
+  /*!
+   * \brief Check and record an access of the scratchpad.
+   * \param stream The ID of the stream accessing.
+   * \param barrier_mask The barrier flags that wait for the stream.
+   * \param spad The index of the scratchpad.
+   * \param base The address of the first byte of the mask.
+   * \param mask The bytes accessed.
+   */
+  void Access(int stream, uint64_t barrier_mask, int spad, int64_t base,
+              const ByteMask &mask, Kind kind);
+
+  /*!
+   * \brief A barrier is issued after all the streams with smaller IDs.
+   * \param id The ID of the barrier.
+   * \param mask The barrier flags to wait for, where 0 waits for all.
+   */
+  void Barrier(int id, uint64_t mask);
+
+  /*!
+   * \brief Retire the barriers, in the order issued, whose streams waited are all done,
+   *        and drop the records of those streams, which cannot race with any later stream.
+   * \param done If the streams before the barrier ID waited by the barrier flags are all done.
+   */
+  template<typename F>
+  void RetireBarriers(F done) {
+    while (!retiring.empty() && done(retiring.front().first, retiring.front().second)) {
+      Drop(retiring.front().first, retiring.front().second);
+      retiring.pop_front();
+    }
+  }
+
+  /*! \brief The racing pairs of streams found. */
+  int64_t races{0};
+
+ private:
+  struct Record {
+    int stream;
+    uint64_t barrier_mask;
+    uint64_t bytes;
+    Kind kind;
+  };
+
+  /*! \brief If a barrier between the two streams waits for the earlier one. */
+  bool Ordered(const Record &a, const Record &b) const;
+
+  void Report(const Record &a, const Record &b, int spad, int64_t line);
+
+  /*! \brief Drop the records of the streams before the barrier waited by its flags. */
+  void Drop(int id, uint64_t mask);
+
+  /*! \brief Check the bytes of a bank line against its records, and record them. */
+  void Touch(int stream, uint64_t barrier_mask, int spad, int64_t line, uint64_t bytes, Kind kind);
+
+  int bank_width;
+  /*! \brief The records of each bank line, keyed by the scratchpad and the line. */
+  std::unordered_map<int64_t, std::vector<Record>> lines;
+  /*! \brief The barriers issued, in the ascending order of their IDs. */
+  std::vector<std::pair<int, uint64_t>> barriers;
+  /*! \brief The barriers whose streams waited are not all done yet, in the order issued. */
+  std::deque<std::pair<int, uint64_t>> retiring;
+  /*! \brief The pairs already reported. */
+  std::set<std::pair<int, int>> reported;
+};
+
+}
+}
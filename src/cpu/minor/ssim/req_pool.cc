@@ -0,0 +1,72 @@
+#include "./req_pool.h"
+
+#include <cstring>
+#include <utility>
+
+#include "dsa/debug.h"
+
+namespace dsa {
+namespace sim {
+
+SSMemReqInfo *ReqInfoPool::Take() {
+  SSMemReqInfo *info = nullptr;
+  if (free.empty()) {
+    storage.emplace_back(-3, 0, 0);
+    info = &storage.back();
+    info->pool = this;
+  } else {
+    info = free.back();
+    free.pop_back();
+  }
+  info->ports.clear();
+  info->mask = ByteMask();
+  info->map.clear();
+  info->gather = false;
+  info->prefetch = false;
+  info->prefetched = false;
+  info->isConfig = false;
+  info->request_cycle = -1;
+  memset(info->breakdown, -1, sizeof info->breakdown);
+  info->released = false;
+  return info;
+}
+
+SSMemReqInfo *ReqInfoPool::Acquire(int stream_id, uint64_t which_accel,
+                                   const std::vector<int> &ports, const ByteMask &mask,
+                                   int64_t request_cycle, const stream::AffineStatus &as) {
+  auto *info = Take();
+  info->stream_id = stream_id;
+  info->trans_idx = ports[0];
+  // Assigned element-wise, so that the capacity of the vectors is reused.
+  info->ports.assign(ports.begin(), ports.end());
+  info->mask = mask;
+  info->as = as;
+  info->which_accel = which_accel;
+  info->request_cycle = request_cycle;
+  return info;
+}
+
+SSMemReqInfo *ReqInfoPool::Acquire(int stream_id, uint64_t which_accel, int trans_idx) {
+  auto *info = Take();
+  info->stream_id = stream_id;
+  info->trans_idx = trans_idx;
+  auto state = std::move(info->as.penetrate_state);
+  state.clear();
+  info->as = stream::AffineStatus();
+  info->as.penetrate_state = std::move(state);
+  info->which_accel = which_accel;
+  return info;
+}
+
+void Release(SSMemReqInfo *info) {
+  if (!info->pool) {
+    delete info;
+    return;
+  }
+  DSA_CHECK(!info->released) << "Request of stream " << info->stream_id << " released twice!";
+  info->released = true;
+  info->pool->free.push_back(info);
+}
+
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "cpu/minor/lsq.hh"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief The records of the memory requests of a lane, recycled when the response is popped.
+ *        The records stay where they are allocated, and their vectors keep the capacity across
+ *        uses, so that a lane in steady state allocates nothing per request.
+ */
+struct ReqInfoPool {
+  /*!
+   * \brief A record of a stream read or write, as the constructor of SSMemReqInfo.
+   */
+  SSMemReqInfo *Acquire(int stream_id, uint64_t which_accel, const std::vector<int> &ports,
+                        const ByteMask &mask, int64_t request_cycle,
+                        const stream::AffineStatus &as);
+
+  /*!
+   * \brief A record of a config load, as the constructor of SSMemReqInfo.
+   */
+  SSMemReqInfo *Acquire(int stream_id, uint64_t which_accel, int trans_idx);
+
+  /*!
+   * \brief The records not released yet.
+   */
+  int in_use() const { return storage.size() - free.size(); }
+
+  /*!
+   * \brief The records ever allocated.
+   */
+  int allocated() const { return storage.size(); }
+
+ private:
+  friend void Release(SSMemReqInfo *info);
+
+  /*!
+   * \brief A record not in use, whose fields are all reset but the vector capacity.
+   */
+  SSMemReqInfo *Take();
+
+  /*!
+   * \brief The records, whose addresses stay when more are allocated.
+   */
+  std::deque<SSMemReqInfo> storage;
+  /*!
+   * \brief The records released.
+   */
+  std::vector<SSMemReqInfo*> free;
+};
+
+/*!
+ * \brief Recycle the record to the pool it is acquired from, or delete it if it is not pooled.
+ */
+void Release(SSMemReqInfo *info);
+
+}
+}
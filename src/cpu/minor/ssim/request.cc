@@ -1,6 +1,5 @@
 #include <algorithm>
-#include <functional>
-#include <numeric>
+#include <cstring>
 
 #include "dsa/debug.h"
 #include "dsa/arch/spad.h"
@@ -33,6 +32,7 @@ void RequestBuffer::Decode(ScratchMemory *parent, int port, MemoryOperation op,
                            const stream::LinearStream::LineInfo &request,
                            const std::vector<uint8_t> &operands) {
   DSA_CHECK(Available()) << "No available slot in the reorder buffer!";
+  scoreboard[tail].reserve(parent->num_banks);
   for (int i = 0; i < parent->num_banks; ++i) {
     Request uop(port, request.linebase + i * parent->bank_width, parent->bank_width, op);
     int l = i * parent->bank_width;
@@ -41,11 +41,11 @@ void RequestBuffer::Decode(ScratchMemory *parent, int port, MemoryOperation op,
       uop.operand = std::vector<uint8_t>(operands.begin() + l, operands.begin() + r);
     }
     DSA_LOG(XBAR) << "Pushed to " << l << ", " << r;
-    uop.mask = std::vector<bool>(request.mask.begin() + l, request.mask.begin() + r);
+    uop.mask = request.mask.slice(l, r);
     scoreboard[tail].emplace_back(parent, uop);
   }
   info[tail] = request;
-  tail = (tail + 1) % scoreboard.size();
+  EnqueueRow(parent);
 }
 
 void RequestBuffer::Decode(ScratchMemory *parent, const std::vector<Request> &requests,
@@ -54,6 +54,7 @@ void RequestBuffer::Decode(ScratchMemory *parent, const std::vector<Request> &re
   const int bank_width = parent->bank_width;
   const int num_banks = parent->num_banks;
   DSA_CHECK(Available()) << "No available slot in the reorder buffer!";
+  scoreboard[tail].reserve(requests.size());
   for (const auto &elem : requests) {
     DSA_CHECK(elem.data_size < bank_width * num_banks)
       << "Request cannot be larger than the bandwidth";
@@ -92,56 +93,70 @@ void RequestBuffer::Decode(ScratchMemory *parent, const std::vector<Request> &re
   }
   info[tail] = meta;
   /* Register the entry on the scoreboard, or maybe we should call it ROB. */
+  EnqueueRow(parent);
+}
+
+void RequestBuffer::EnqueueRow(ScratchMemory *parent) {
+  auto &row = scoreboard[tail];
+  uncommitted[tail] = row.size();
+  // The row is not resized any more, so the entries can be referred to from now on.
+  for (auto &entry : row) {
+    entry.seq = decoded++;
+    entry.row = tail;
+    Enqueue(parent, &entry);
+  }
   tail = (tail + 1) % scoreboard.size();
 }
 
-void InputBuffer::PushRequests(ScratchMemory *parent) {
-  int num_banks = parent->num_banks;
-  /* If two address go to the same bank, we only allow the first one. */
-  std::vector<int> cnt(num_banks, 0);
-  int issue_checked = 0;
-  bool head_found = false;
+void RequestBuffer::Retire(Entry *entry) {
+  DSA_CHECK(entry->status != Entry::Status::Commit);
+  entry->status = Entry::Status::Commit;
+  --uncommitted[entry->row];
+}
 
-  for (int i = 0, n = scoreboard.size(); i < n; ++i) {
-    auto &refer = scoreboard[(i + front) % scoreboard.size()];
-    for (int j = 0, m = refer.size(); j < m; ++j) {
-      auto &elem = refer[j];
-      int bankno = refer[j].bankno();
-      if (elem.status == Entry::Status::NotIssued) {
-        head_found = true;
-        auto pred = std::accumulate(elem.request.mask.begin(), elem.request.mask.end(), 0,
-                                    std::plus<int>());
-        if (pred) {
-          DSA_LOG(IDLE)
-            << issue_checked << ": try to issue "
-            << i << "," << j << " to " << bankno;
-          if (cnt[bankno] >= provision) {
-            DSA_LOG(IDLE) << bankno << " over provisioned!";
-          } else {
-            if (!parent->banks[bankno].Available()) {
-              DSA_LOG(IDLE) << bankno << " task fifo overwhelmed!";
-            } else {
-              ++cnt[bankno];
-              parent->banks[bankno].task_fifo.push(&refer[j]);
-              refer[j].status = Entry::Status::InFIFO;
-              DSA_LOG(XBAR) << "[" << i << "] Push micro code "
-                          << refer[j].request << " to bank " << bankno;
-            }
-          }
-        } else {
-          elem.status = Entry::Status::Commit;
-        }
-      } else {
-        DSA_LOG(XBAR) << "[" << i << "] Already issued: @"
-                    << STATUS[(int) elem.status] << " " << elem.request;
-      }
-      if (head_found) {
-        if (++issue_checked > issue_width) {
-          return;
-        }
+void InputBuffer::Enqueue(ScratchMemory *parent, Entry *entry) {
+  if ((int) ready.size() < parent->num_banks) {
+    ready.resize(parent->num_banks);
+  }
+  pending.push_back(entry);
+  if (entry->request.mask.any()) {
+    ready[entry->bankno()].push_back(entry);
+  } else {
+    idle.push_back(entry);
+  }
+}
+
+void InputBuffer::PushRequests(ScratchMemory *parent) {
+  if (pending.empty()) {
+    return;
+  }
+  /* Only the entries within the issue width from the oldest one not issued are checked. */
+  uint64_t last = pending.front()->seq + issue_width;
+  while (!idle.empty() && idle.front()->seq <= last) {
+    Retire(idle.front());
+    idle.pop_front();
+  }
+  /* If two address go to the same bank, we only allow the first ones. */
+  for (int i = 0, n = ready.size(); i < n; ++i) {
+    auto &bank = parent->banks[i];
+    auto &queue = ready[i];
+    for (int cnt = 0; cnt < provision && !queue.empty() && queue.front()->seq <= last; ++cnt) {
+      if (!bank.Available()) {
+        DSA_LOG(IDLE) << i << " task fifo overwhelmed!";
+        break;
       }
+      auto *entry = queue.front();
+      queue.pop_front();
+      bank.task_fifo.push(entry);
+      entry->status = Entry::Status::InFIFO;
+      DSA_LOG(XBAR) << "[" << entry->row << "] Push micro code "
+                    << entry->request << " to bank " << i;
     }
   }
+  // Drop the issued ones now, because their rows may be committed and reused afterwards.
+  while (!pending.empty() && pending.front()->status != Entry::Status::NotIssued) {
+    pending.pop_front();
+  }
 }
 
 Response RequestBuffer::Commit() {
@@ -152,21 +167,18 @@ Response RequestBuffer::Commit() {
   if (!scoreboard[front].empty()) {
     port = scoreboard[front][0].request.port;
     op = scoreboard[front][0].request.op;
-    for (int i = 0; i < (int) scoreboard[front].size(); ++i) {
-      if (scoreboard[front][i].status != Entry::Status::Commit) {
-        DSA_LOG(RETIRE) << "[" << front << "] " << scoreboard[front][i].request
-                      << " is not committed yet! "
-                      << STATUS[(int) scoreboard[front][i].status];
-        return Response();
-      }
+    if (uncommitted[front]) {
+      DSA_LOG(RETIRE) << "[" << front << "] " << uncommitted[front]
+                      << " entries are not committed yet!";
+      return Response();
     }
     DSA_LOG(RETIRE) << "Row " << front << " is retiring";
+    int bank_width = scoreboard[front][0].parent->bank_width;
+    res.resize(scoreboard[front].size() * bank_width);
     for (int i = 0; i < (int) scoreboard[front].size(); ++i) {
-      auto &entry = scoreboard[front][i];
-      res.insert(res.end(), entry.result.begin(), entry.result.end());
+      memcpy(res.data() + i * bank_width, scoreboard[front][i].result, bank_width);
     }
     scoreboard[front].clear();
-    scoreboard[front].shrink_to_fit();
     meta = info[front];
     // info[front] = stream::LinearStream::LineInfo();
     ++front;
@@ -176,7 +188,8 @@ Response RequestBuffer::Commit() {
 }
 
 RequestBuffer::RequestBuffer(int sb_size) :
-  scoreboard(sb_size), info(sb_size, stream::LinearStream::LineInfo(0, 0, {}, 0)) {}
+  scoreboard(sb_size), info(sb_size, stream::LinearStream::LineInfo(0, 0, {}, 0)),
+  uncommitted(sb_size, 0) {}
 
 InputBuffer::InputBuffer(int size, int issue_width_, int provision_) :
   RequestBuffer(size), issue_width(issue_width_), provision(provision_) {}
@@ -233,6 +246,18 @@ void LinkBuffer::PushRequests(ScratchMemory *parent) {
 LinkBuffer::LinkBuffer(int sb_size, int bank_size)
    : RequestBuffer(sb_size), grid(bank_size, std::vector<Entry*>(sb_size, nullptr)) {}
 
+RequestBuffer *RequestBuffer::Create(const std::string &policy, int sb_size, int issue_width,
+                                     int provision, int num_banks) {
+  if (policy == "input") {
+    return new InputBuffer(sb_size, issue_width, provision);
+  }
+  if (policy == "link") {
+    return new LinkBuffer(sb_size, num_banks);
+  }
+  DSA_CHECK(false) << "Unknown scratchpad request buffer: " << policy << ", expected input or link";
+  return nullptr;
+}
+
 
 uint64_t Entry::bankno() {
   return (request.addr / parent->bank_width) % parent->num_banks;
@@ -1,5 +1,7 @@
 #include <cstdint>
 #include <climits>
+#include <deque>
+#include <string>
 #include <vector>
 
 #include "dsa-ext/rf.h"
@@ -32,7 +34,7 @@ struct Request {
   /*!
    * \brief The predication of accessing each addressable element in this bank line.
    */
-  std::vector<bool> mask;
+  ByteMask mask;
   /*!
    * \brief The operands of atomic operation.
    */
@@ -63,9 +65,15 @@ struct Entry {
   Request request;
 
   /*!
-   * \brief The result of atomic operation.
+   * \brief The widest bank line supported, in bytes.
    */
-  std::vector<uint8_t> result;
+  static const int MAX_BANK_WIDTH = 64;
+
+  /*!
+   * \brief The bank line read, and then updated by the atomic operation in place.
+   *        Only the first bank_width bytes are used.
+   */
+  uint8_t result[MAX_BANK_WIDTH];
 
   enum class Status { NotIssued, InFIFO, Access, Compute, Write, Commit };
   /*!
@@ -73,6 +81,16 @@ struct Entry {
    */
   Status status{Status::NotIssued};
 
+  /*!
+   * \brief The order of decoding this entry, counted by the request buffer.
+   */
+  uint64_t seq{0};
+
+  /*!
+   * \brief The row of the request buffer this entry belongs to.
+   */
+  int row{-1};
+
   /*!
    * \brief Bank number.
    */
@@ -103,14 +121,38 @@ struct RequestBuffer {
 
   /* \brief A repetitive queue for filling the requests */
   int front{0}, tail{0};
+  /*!
+   * \brief The rows of entries. A row keeps its storage after it is committed,
+   *        so that the following decodings reuse it.
+   */
   std::vector<std::vector<Entry>> scoreboard;
   std::vector<stream::LinearStream::LineInfo> info;
+  /*!
+   * \brief The entries not committed yet of each row.
+   */
+  std::vector<int> uncommitted;
+  /*!
+   * \brief The number of entries decoded so far.
+   */
+  uint64_t decoded{0};
 
   RequestBuffer(int sb_size);
 
+  virtual ~RequestBuffer() {}
+
   /* \brief The strategy of pushing requests */
   virtual void PushRequests(ScratchMemory *parent) = 0;
 
+  /*!
+   * \brief Track the entry just decoded to the last row.
+   */
+  virtual void Enqueue(ScratchMemory *parent, Entry *entry) {}
+
+  /*!
+   * \brief Mark the entry committed.
+   */
+  void Retire(Entry *entry);
+
   /*!
    * \brief If this request buffer is available to process requests.
    */
@@ -125,14 +167,33 @@ struct RequestBuffer {
               const stream::LinearStream::LineInfo &request,
               const std::vector<uint8_t> &operands);
 
+  /* \brief Register the entries of the row just decoded, and move on to the next row. */
+  void EnqueueRow(ScratchMemory *parent);
+
   /* \brief If there is ongoing requests */
   bool Active();
 
   /* \brief Commit the complete requests */
   Response Commit();
+
+  /*!
+   * \brief Create a request buffer by the name of the policy.
+   * \param policy "input" for InputBuffer, or "link" for LinkBuffer.
+   * \param sb_size The rows of requests buffered.
+   * \param issue_width The entries checked to issue in a cycle, only for InputBuffer.
+   * \param provision The entries each bank takes in a cycle, only for InputBuffer.
+   * \param num_banks The number of banks of the scratchpad.
+   */
+  static RequestBuffer *Create(const std::string &policy, int sb_size, int issue_width,
+                               int provision, int num_banks);
 };
 
-/* \brief The InputBuffer strategy */
+/*!
+ * \brief The InputBuffer strategy. From the oldest entry not issued yet, the following
+ *        issue_width entries are checked each cycle, and each bank takes at most provision
+ *        of them in order. The entries not issued yet are queued by bank when decoded,
+ *        so that a cycle only looks at the heads of the queues.
+ */
 struct InputBuffer : RequestBuffer {
   int issue_width;
   int provision{1};
@@ -141,6 +202,16 @@ struct InputBuffer : RequestBuffer {
 
   /* \brief The strategy of pushing requests */
   void PushRequests(ScratchMemory *parent) override;
+
+  void Enqueue(ScratchMemory *parent, Entry *entry) override;
+
+ private:
+  /*! \brief The entries to issue of each bank, in the order of decoding. */
+  std::vector<std::deque<Entry*>> ready;
+  /*! \brief The entries predicated off, which are committed without issuing. */
+  std::deque<Entry*> idle;
+  /*! \brief The entries in the order of decoding, popped once issued. */
+  std::deque<Entry*> pending;
 };
 
 /* \brief The LinkBuffer strategy */
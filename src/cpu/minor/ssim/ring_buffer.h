@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "dsa/debug.h"
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief A FIFO on a cache-aligned circular storage, which replaces std::deque for the port buffers.
+ *        The capacity is reserved when the port is built, so that the data are moved
+ *        by pushing, peeking, and popping spans without allocation.
+ *        The storage is only regrown if the reservation is exceeded.
+ * \tparam T The element type, which should be trivially copyable.
+ */
+template<typename T>
+class RingBuffer {
+  static_assert(std::is_trivially_copyable<T>::value, "RingBuffer only moves trivial data!");
+
+ public:
+  /*!
+   * \brief A read-only window of consecutive elements in the FIFO.
+   */
+  struct View {
+    const RingBuffer *rb;
+    int offset;
+    int n;
+
+    size_t size() const { return n; }
+    bool empty() const { return n == 0; }
+    const T &operator[](int i) const { return (*rb)[offset + i]; }
+  };
+
+  explicit RingBuffer(int capacity = 0) { reserve(capacity); }
+
+  RingBuffer(const RingBuffer &other) {
+    reserve(other.size());
+    for (int i = 0; i < (int) other.size(); ++i) {
+      push_back(other[i]);
+    }
+  }
+
+  RingBuffer(RingBuffer &&other) noexcept
+    : base(other.base), data(other.data), mask(other.mask), head(other.head), n(other.n) {
+    other.base = nullptr;
+    other.data = nullptr;
+    other.mask = -1;
+    other.head = other.n = 0;
+  }
+
+  RingBuffer &operator=(RingBuffer other) {
+    std::swap(base, other.base);
+    std::swap(data, other.data);
+    std::swap(mask, other.mask);
+    std::swap(head, other.head);
+    std::swap(n, other.n);
+    return *this;
+  }
+
+  ~RingBuffer() { std::free(base); }
+
+  size_t size() const { return n; }
+
+  bool empty() const { return n == 0; }
+
+  int capacity() const { return mask + 1; }
+
+  const T &operator[](int i) const { return data[(head + i) & mask]; }
+
+  T &operator[](int i) { return data[(head + i) & mask]; }
+
+  const T &front() const { return (*this)[0]; }
+
+  const T &back() const { return (*this)[n - 1]; }
+
+  void clear() { head = n = 0; }
+
+  /*!
+   * \brief Make sure the FIFO holds no fewer than the given elements without regrowing.
+   */
+  void reserve(int cap) {
+    if (cap <= capacity()) {
+      return;
+    }
+    int new_cap = 1;
+    while (new_cap < cap) {
+      new_cap <<= 1;
+    }
+    void *new_base = std::malloc(new_cap * sizeof(T) + kAlign);
+    if (!new_base) {
+      throw std::bad_alloc();
+    }
+    auto addr = reinterpret_cast<uintptr_t>(new_base);
+    T *new_data = reinterpret_cast<T*>((addr + kAlign - 1) & ~(uintptr_t) (kAlign - 1));
+    peek(new_data, n);
+    std::free(base);
+    base = new_base;
+    data = new_data;
+    mask = new_cap - 1;
+    head = 0;
+  }
+
+  void push_back(const T &value) {
+    if (n == capacity()) {
+      reserve(n + 1);
+    }
+    data[(head + n) & mask] = value;
+    ++n;
+  }
+
+  template<typename ...Args>
+  void emplace_back(Args&& ...args) {
+    push_back(T(std::forward<Args>(args)...));
+  }
+
+  /*!
+   * \brief Append a span of elements to the FIFO.
+   */
+  void push(const T *src, int cnt) {
+    if (cnt == 0) {
+      return;
+    }
+    if (n + cnt > capacity()) {
+      reserve(n + cnt);
+    }
+    int tail = (head + n) & mask;
+    int first = std::min(cnt, capacity() - tail);
+    std::memcpy(data + tail, src, first * sizeof(T));
+    std::memcpy(data, src + first, (cnt - first) * sizeof(T));
+    n += cnt;
+  }
+
+  /*!
+   * \brief Copy the leading elements of the FIFO to a span, without popping them.
+   */
+  void peek(T *dst, int cnt) const {
+    DSA_CHECK(cnt <= n) << "Peek " << cnt << " out of " << n << " element(s)";
+    if (cnt == 0) {
+      return;
+    }
+    int first = std::min(cnt, capacity() - head);
+    std::memcpy(dst, data + head, first * sizeof(T));
+    std::memcpy(dst + first, data, (cnt - first) * sizeof(T));
+  }
+
+  /*!
+   * \brief A window of the leading elements of the FIFO.
+   */
+  View view(int cnt, int offset = 0) const {
+    DSA_CHECK(offset + cnt <= n) << "View [" << offset << ", " << offset + cnt << ") out of " << n;
+    return View{this, offset, cnt};
+  }
+
+  /*!
+   * \brief Pop the leading elements of the FIFO.
+   */
+  void pop(int cnt) {
+    DSA_CHECK(cnt <= n) << "Pop " << cnt << " out of " << n << " element(s)";
+    head = (head + cnt) & mask;
+    n -= cnt;
+  }
+
+ private:
+  /*!
+   * \brief The alignment of the storage, a cacheline.
+   */
+  static constexpr int kAlign = 64;
+  /*!
+   * \brief The allocated memory, and the aligned elements in it.
+   */
+  void *base{nullptr};
+  T *data{nullptr};
+  /*!
+   * \brief The capacity is always a power of 2, so that indices wrap around by masking.
+   */
+  int mask{-1};
+  int head{0};
+  int n{0};
+};
+
+}
+}
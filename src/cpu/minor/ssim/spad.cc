@@ -1,3 +1,6 @@
+#include <cstring>
+#include <type_traits>
+
 #include "dsa/debug.h"
 #include "dsa-ext/rf.h"
 #include "./spad.h"
@@ -6,11 +9,62 @@
 namespace dsa {
 namespace sim {
 
+namespace {
+
+/*!
+ * \brief Apply the atomic operation on all the lanes of a bank line in place.
+ *        The lanes are loaded to arrays and computed by branch-free loops, so that
+ *        the compiler can vectorize them. Add, Sub and Mul are done unsigned, which gives
+ *        the same bits as the signed ones truncated, without overflows. The lanes narrower
+ *        than int are widened to unsigned, otherwise they are promoted to signed int.
+ * \tparam T The signed data type of a lane.
+ * \param line The bank line, overwritten by the result.
+ * \param operand The operands aligned with the bank line.
+ * \param bytes The bytes of the bank line.
+ */
+template<typename T>
+void AtomicLine(MemoryOperation op, uint8_t *line, const uint8_t *operand, int bytes) {
+  typedef typename std::make_unsigned<T>::type U;
+  typedef typename std::conditional<(sizeof(U) < sizeof(unsigned)), unsigned, U>::type W;
+  const int n = Entry::MAX_BANK_WIDTH / sizeof(T);
+  T a[n], b[n];
+  int m = bytes / sizeof(T);
+  memcpy(a, line, bytes);
+  memcpy(b, operand, bytes);
+  switch (op) {
+    case MemoryOperation::DMO_Add:
+      for (int i = 0; i < m; ++i) a[i] = (U) ((W) (U) a[i] + (W) (U) b[i]);
+      break;
+    case MemoryOperation::DMO_Sub:
+      for (int i = 0; i < m; ++i) a[i] = (U) ((W) (U) a[i] - (W) (U) b[i]);
+      break;
+    case MemoryOperation::DMO_Mul:
+      for (int i = 0; i < m; ++i) a[i] = (U) ((W) (U) a[i] * (W) (U) b[i]);
+      break;
+    case MemoryOperation::DMO_Max:
+      for (int i = 0; i < m; ++i) a[i] = a[i] < b[i] ? b[i] : a[i];
+      break;
+    case MemoryOperation::DMO_Min:
+      for (int i = 0; i < m; ++i) a[i] = b[i] < a[i] ? b[i] : a[i];
+      break;
+    case MemoryOperation::DMO_Write:
+      memcpy(a, b, bytes);
+      break;
+    default:
+      DSA_CHECK(false) << (int) op << " is not a operation";
+  }
+  memcpy(line, a, bytes);
+}
+
+}
+
 ScratchMemory::ScratchMemory(int line_size_, int num_banks_, int capacity_, int fifo_size_, RequestBuffer *rb_) :
   adg::ScratchMemory(line_size_, num_banks_, capacity_), rb(rb_) {
   DSA_CHECK(num_bytes % num_banks == 0) << "Memory size " << num_bytes << " is not divisible by #banks " << num_banks;
   DSA_CHECK((num_banks & -num_banks) == num_banks)
     << "#Banks is not a power of 2, " << num_banks << " " << (num_banks & -num_banks);
+  DSA_CHECK(bank_width <= Entry::MAX_BANK_WIDTH)
+    << "Bank width " << bank_width << " exceeds " << Entry::MAX_BANK_WIDTH;
   banks.reserve(num_banks);
   for (int i = 0; i < num_banks; ++i) {
     banks.emplace_back(this, i, fifo_size_, num_bytes / num_banks);
@@ -18,7 +72,9 @@ ScratchMemory::ScratchMemory(int line_size_, int num_banks_, int capacity_, int
 }
 
 Entry::Entry(ScratchMemory *parent_, const Request &request_) :
-  parent(parent_), request(request_), result(parent_->bank_width) {}
+  parent(parent_), request(request_) {
+  memset(result, 0, parent->bank_width);
+}
 
 Bank::Bank(ScratchMemory *parent_, int bankno_, int fifo_size_, int bytes) :
   parent(parent_), bankno(bankno_), fifo_size(fifo_size_), data(bytes, 0),
@@ -67,7 +123,7 @@ void Bank::AccessData() {
   DSA_CHECK(addr < data.size())
     << "addr: " << read->request.addr << ", cacheline: "<< read->cacheline()
     << ", size: " << data.size();
-  read->result = std::vector<uint8_t>(data.begin() + addr, data.begin() + addr + parent->bank_width);
+  memcpy(read->result, data.data() + addr, parent->bank_width);
   (compute = read)->status = Entry::Status::Compute;
   read = nullptr;
 }
@@ -85,63 +141,38 @@ void Bank::InsituCompute() {
     return;
   }
 
-  auto l = data.begin() + compute->cacheline();
-  // auto r = l + parent->bank_width;
   if (compute->request.op != MemoryOperation::DMO_Read) {
-    auto f = [](int64_t a, int64_t b, MemoryOperation op) -> int64_t {
-      switch(op) {
-        case MemoryOperation::DMO_Add:
-          return a + b;
-        case MemoryOperation::DMO_Sub:
-          return a - b;
-        case MemoryOperation::DMO_Mul:
-          return a * b;
-        case MemoryOperation::DMO_Max:
-          return std::max(a, b);
-        case MemoryOperation::DMO_Min:
-          return std::min(a, b);
-        case MemoryOperation::DMO_Write:
-          return b;
-        default:
-          DSA_CHECK(false) << (int) op << " is not a operation";
-      }
-      return -1;
-    };
-    for (int i = 0; i < parent->bank_width; i += compute->request.data_size) {
-      for (int j = 1; j < compute->request.data_size; ++j) {
-        DSA_CHECK(compute->request.mask[i] == compute->request.mask[i + j])
+    const auto &request = compute->request;
+    int bank_width = parent->bank_width;
+    for (int i = 0; i < bank_width; i += request.data_size) {
+      for (int j = 1; j < request.data_size; ++j) {
+        DSA_CHECK(request.mask[i] == request.mask[i + j])
           << i << ", " << j
           << " Data operation should not be in sub-dtype granularity!";
       }
-      std::vector<uint8_t> a(l + i, l + i + compute->request.data_size);
-      std::vector<uint8_t> b(compute->request.operand.begin() + i,
-                             compute->request.operand.begin() + i + compute->request.data_size);
-      int64_t res = 0;
-      switch (compute->request.data_size * 8) {
-      #define BW_IMPL(bw)                                    \
-        case bw:                                             \
-          DSA_CHECK(a.size() == bw / 8);                         \
-          DSA_CHECK(b.size() == bw / 8);                         \
-          res = f(*reinterpret_cast<int##bw##_t*>(a.data()), \
-                  *reinterpret_cast<int##bw##_t*>(b.data()), \
-                  compute->request.op);                      \
-          break;
-        BW_IMPL(8)
-        BW_IMPL(16)
-        BW_IMPL(32)
-        BW_IMPL(64)
-      #undef BW_IMPL
-        default:
-          DSA_CHECK(false) << compute->request.data_size * 8 << " is not a power of 2!";
-      }
-      std::vector<uint8_t> c((uint8_t*)(&res), (uint8_t*)(&res) + 8);
-      for (int j = 0; j < compute->request.data_size; ++j) {
-        compute->result[i + j] = c[j];
-      }
+    }
+    // An indirect request carries the operand of its element only,
+    // which is aligned to the lane of the element in the bank line.
+    uint8_t operand[Entry::MAX_BANK_WIDTH];
+    if ((int) request.operand.size() == bank_width) {
+      memcpy(operand, request.operand.data(), bank_width);
+    } else {
+      int offset = request.addr % bank_width;
+      DSA_CHECK((int) request.operand.size() == request.data_size &&
+                offset + request.data_size <= bank_width)
+        << request.operand.size() << " " << request.data_size << " @" << offset;
+      memset(operand, 0, bank_width);
+      memcpy(operand + offset, request.operand.data(), request.data_size);
+    }
+    switch (request.data_size) {
+      case 1: AtomicLine<int8_t>(request.op, compute->result, operand, bank_width); break;
+      case 2: AtomicLine<int16_t>(request.op, compute->result, operand, bank_width); break;
+      case 4: AtomicLine<int32_t>(request.op, compute->result, operand, bank_width); break;
+      case 8: AtomicLine<int64_t>(request.op, compute->result, operand, bank_width); break;
+      default:
+        DSA_CHECK(false) << request.data_size * 8 << " is not a power of 2!";
     }
   }
-  DSA_CHECK(compute->result.size() == parent->bank_width)
-    << compute->result.size() << " == " << parent->bank_width;
   write = compute;
   compute = nullptr;
 }
@@ -152,18 +183,17 @@ void Bank::WriteBack() {
     DSA_LOG(ADDR)
       << "bank: " << bankno << ", port: " << write->request.port
       << ", addr: " << write->request.addr
-      << ", " << write->result.size() << "-byte:"
-      << *reinterpret_cast<uint64_t*>(write->result.data());
+      << ", " << parent->bank_width << "-byte:"
+      << *reinterpret_cast<uint64_t*>(write->result);
     DSA_CHECK(addr < data.size()) << addr;
     if (write->request.op != MemoryOperation::DMO_Read) {
-      for (int i = 0; i < parent->bank_width; ++i) {
-        if (write->request.mask[i]) {
-          data[addr + i] = write->result[i];
-        }
-      }
+      const uint8_t *result = write->result;
+      write->request.mask.forEach([this, addr, result] (int i) {
+        data[addr + i] = result[i];
+      });
       DSA_LOG(COMMIT) << " [Commit] " << bankno << ": Commit " << write->request;
     }
-    write->status = Entry::Status::Commit;
+    parent->rb->Retire(write);
     write = nullptr;
     return;
   }
@@ -188,5 +218,15 @@ Response ScratchMemory::Step() {
   return memory.rb->Commit();
 }
 
+void ScratchMemory::SkipIdle(int64_t cycles) {
+  for (auto &bank : banks) {
+    DSA_CHECK(bank.task_fifo.empty() && !bank.read && !bank.compute && !bank.write);
+    bank.stat.task_idle += cycles;
+    bank.stat.read_idle += cycles;
+    bank.stat.compute_idle += cycles;
+    bank.stat.write_idle += cycles;
+  }
+}
+
 }
 }
@@ -76,6 +76,9 @@ struct ScratchMemory : adg::ScratchMemory {
   /* \brief Simulate the memory system. */
   Response Step();
 
+  /* \brief Account the idle statistics of the steps skipped when no request is active. */
+  void SkipIdle(int64_t cycles);
+
   int bandwidth() { return bank_width * num_banks; }
 
 };
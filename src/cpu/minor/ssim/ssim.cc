@@ -6,6 +6,7 @@
 #include <iomanip>
 #include <memory>
 #include <assert.h>
+#include <chrono>
 
 #include "json/json.h"
 #include "dsa/core/utils.h"
@@ -13,19 +14,87 @@
 #include "ssim.hh"
 #include "../cpu.hh"
 #include "../exec_context.hh"
+#include "params/MinorCPU.hh"
+#include "./byte_mask.h"
 #include "./ism.h"
 
 using namespace std;
 
 // Vector-Stream Commands (all of these are context-dependent)
 
-ssim_t::ssim_t(Minor::LSQ *lsq_) : lsq_(lsq_), statistics(*this) {
+ssim_t::ssim_t(Minor::LSQ *lsq, const MinorCPUParams &params)
+    : ssim_t(new dsa::sim::LSQMemory(lsq), params) {
+  _lsq_memory.reset(static_cast<dsa::sim::LSQMemory*>(lsq_));
+}
+
+ssim_t::ssim_t(dsa::sim::MemoryInterface *lsq_, const MinorCPUParams &params)
+    : lsq_(lsq_), statistics(*this) {
 
   const char *req_core_id_str = std::getenv("DBG_CORE_ID");
   if (req_core_id_str != nullptr) {
     _req_core_id = atoi(req_core_id_str);
   }
 
+  spec.arbiter = params.ssArbiter;
+  spec.lane_threads = params.ssLaneThreads;
+  spec.spad_banks = params.ssSpadBanks;
+  spec.spad_bank_width = params.ssSpadBankWidth;
+  spec.spad_fifo_depth = params.ssSpadFifoDepth;
+  spec.spad_rob_size = params.ssSpadRobSize;
+  spec.spad_issue_width = params.ssSpadIssueWidth;
+  spec.spad_provision = params.ssSpadProvision;
+  spec.spad_buffer = params.ssSpadBuffer;
+  spec.fast_forward = params.ssFastForward;
+
+  // The spec should be finalized before the lanes are built upon it.
+  if (std::getenv("DSA_SPEC")) {
+    std::string dsa_spec(std::getenv("DSA_SPEC"));
+    Json::Value raw_json = dsa::core::utils::LoadJsonFromFile(dsa_spec);
+    #define SPEC_ATTR(TY, ID, VAL) if (raw_json.isMember(#ID)) { spec.ID = raw_json[#ID].as<TY>(); }
+    #include "./spec.attr"
+    #undef SPEC_ATTR
+  }
+  // A response is only delivered whole, so a narrower return bus never delivers any.
+  DSA_CHECK(spec.dma_return_bandwidth == -1 || spec.dma_return_bandwidth >= spec.dma_bandwidth)
+    << "dma_return_bandwidth " << spec.dma_return_bandwidth << " cannot return a line of "
+    << spec.dma_bandwidth << " bytes, -1 for unbounded!";
+  // A DMA line is carried in one byte mask.
+  DSA_CHECK(spec.dma_bandwidth > 0 && spec.dma_bandwidth <= dsa::sim::ByteMask::MAX_BITS)
+    << "dma_bandwidth " << spec.dma_bandwidth << " is not within the widest mask of "
+    << dsa::sim::ByteMask::MAX_BITS << " bytes!";
+  // The scratchpad addresses are split into bank lines by masking, and a request row is
+  // packed in one byte mask, so the geometry is checked before any lane is built upon it.
+  auto is_pow2 = [](int x) { return x > 0 && (x & -x) == x; };
+  DSA_CHECK(is_pow2(spec.spad_banks)) << "spad_banks " << spec.spad_banks << " is not a power of 2!";
+  DSA_CHECK(is_pow2(spec.spad_bank_width) &&
+            spec.spad_bank_width <= dsa::sim::Entry::MAX_BANK_WIDTH)
+    << "spad_bank_width " << spec.spad_bank_width << " is not a power of 2 within "
+    << dsa::sim::Entry::MAX_BANK_WIDTH << " bytes!";
+  DSA_CHECK(spec.spad_banks * spec.spad_bank_width <= dsa::sim::ByteMask::MAX_BITS)
+    << "A scratchpad row of " << spec.spad_banks << " x " << spec.spad_bank_width
+    << " bytes exceeds the widest mask of " << dsa::sim::ByteMask::MAX_BITS << " bytes!";
+  DSA_CHECK(SCRATCH_SIZE % (spec.spad_banks * spec.spad_bank_width) == 0)
+    << "A scratchpad of " << SCRATCH_SIZE << " bytes is not made of whole rows of "
+    << spec.spad_banks << " x " << spec.spad_bank_width << " bytes!";
+  DSA_CHECK(spec.spad_fifo_depth > 0) << "spad_fifo_depth " << spec.spad_fifo_depth << " is not positive!";
+  DSA_CHECK(spec.spad_rob_size > 0 && spec.spad_issue_width > 0 && spec.spad_provision > 0)
+    << "The scratchpad request buffer of " << spec.spad_rob_size << " rows, "
+    << spec.spad_issue_width << " issue width, " << spec.spad_provision
+    << " provision never issues!";
+  DSA_CHECK(spec.dma_gather_window > 0)
+    << "dma_gather_window " << spec.dma_gather_window << " never gathers an element!";
+
+  if (!spec.trace_file.empty()) {
+    trace.reset(new dsa::sim::TraceSink(spec.trace_file + "." + std::to_string(lsq_->getCpuId())));
+  }
+
+  if (!spec.timeline_file.empty()) {
+    DSA_CHECK(spec.timeline_interval > 0) << "The timeline is dumped, but never sampled!";
+    timeline.open(spec.timeline_file + "." + std::to_string(lsq_->getCpuId()),
+                  std::ofstream::trunc | std::ofstream::out);
+    DSA_CHECK(timeline.good()) << "Cannot open " << spec.timeline_file;
+  }
+
   lanes.resize(spec.num_of_lanes + 1);
   for(int i = 0; i < (int) lanes.size(); ++i) {
     lanes[i] = new accel_t(i, this);
@@ -33,20 +102,18 @@ ssim_t::ssim_t(Minor::LSQ *lsq_) : lsq_(lsq_), statistics(*this) {
   //lanes[SHARED_SP] = new accel_t(lsq, SHARED_SP, this);
   //TODO: inform lanes
 
+  _dispatcher.reset(new dsa::sim::CommandDispatcher(this));
+
+  if (spec.lane_threads > 1) {
+    _lane_pool.reset(new dsa::sim::LanePool(spec.lane_threads));
+  }
+
   // set indirect ports to be 1-byte by default
   for (int i = 0; i < DSARF::TOTAL_REG; ++i) {
     rf[i].value = REG_DEFAULT[i];
     rf[i].sticky = REG_STICKY[i];
   }
 
-  if (std::getenv("DSA_SPEC")) {
-    std::string dsa_spec(std::getenv("DSA_SPEC"));
-    Json::Value raw_json = dsa::core::utils::LoadJsonFromFile(dsa_spec);
-    #define SPEC_ATTR(TY, ID, VAL) if (raw_json.isMember(#ID)) { spec.ID = raw_json.as<TY>(); }
-    #include "./spec.attr"
-    #undef SPEC_ATTR
-  }
-
 }
 
 void ssim_t::LoadBitstream() {
@@ -83,16 +150,15 @@ void ssim_t::LoadBitstream() {
     << now() << ": Request 0x" << std::hex << addr
     << ", " << std::dec << size << " to configure";
 
-  SSMemReqInfoPtr sdInfo = new SSMemReqInfo(-4, context, CONFIG_STREAM);
+  // The config loads are few, so all of them are recycled to the first lane.
+  SSMemReqInfoPtr sdInfo = lanes[0]->req_pool.Acquire(-4, context, CONFIG_STREAM);
 
   lsq()->pushRequest(inst, true /*isLoad*/, NULL /*data*/,
-                    size * 8 /*cache line*/, addr, 0 /*flags*/, 0 /*res*/,
-                    nullptr /*atom op*/, std::vector<bool>() /*byte enable*/,
-                    sdInfo);
+                    size * 8 /*cache line*/, addr, sdInfo);
 
 }
 
-Minor::LSQ *ssim_t::lsq() {
+dsa::sim::MemoryInterface *ssim_t::lsq() {
   return lsq_;
 }
 
@@ -285,299 +351,7 @@ int64_t ssim_t::CurrentCycle() {
 }
 
 void ssim_t::DispatchStream() {
-
-  struct DispatchChecker : dsa::sim::stream::Functor {
-    DispatchChecker(accel_t *accel_) : accel(accel_) {}
-
-    /*!
-     * \brief Check the avaiability of the ports of this stream.
-     * \param is The input stream to be scheduled.
-     */
-    bool IVPAvailable(const std::vector<PortExecState> &pes) {
-      for (auto &elem : pes) {
-        auto &in = accel->input_ports[elem.port];
-        if (in.stream) {
-          DSA_LOG(CMD_BLOCK) << "ivp" << elem.port << " serving stream " << in.stream->toString();
-          return false;
-        }
-        if (std::find(iports.begin(), iports.end(), elem.port) != iports.end()) {
-          DSA_LOG(CMD_BLOCK) << "ivp" << elem.port << " is enforced by previous conflict port!";
-          return false;
-        }
-        if (!in.buffer.empty()) {
-          DSA_LOG(CMD_BLOCK)
-            << "ivp" << elem.port << " buffer not empty! Buffer: "
-            << in.buffer.size();
-          if (in.pes.exec_repeat() == 1 && in.pes.stretch == 0) {
-            if (elem.repeat == in.pes.repeat && elem.stretch == in.pes.stretch) {
-              DSA_LOG(CMD_BLOCK) << "However, repeat matches, skip!";
-              continue;
-            }
-          }
-          return false;
-          // FIXME(@were): This can be more aggressive, but what should I do?
-          // if (elem.repeat != in.pes.repeat ||
-          //     elem.period != in.pes.period ||
-          //     elem.stretch != in.pes.stretch) {
-          //   return false;
-          // }
-        }
-      }
-      return true;
-    }
-
-    bool OVPAvailable(const std::vector<int> &ports) {
-      for (auto port : ports) {
-        auto &out = accel->output_ports[port];
-        if (out.stream) {
-          DSA_LOG(CMD_BLOCK) << "ovp" << port << " is serving " << out.stream->toString();
-          return false;
-        }
-        if (std::find(oports.begin(), oports.end(), port) != oports.end()) {
-          DSA_LOG(CMD_BLOCK) << "ovp" << port << " is enforced by conflict streams!";
-          return false;
-        }
-      }
-      return true;
-    }
-
-    /*!
-     * \brief Enforce the barrier.
-     */
-    void Visit(Barrier *bar) override {
-      // Add the bits to be blocked.
-      barrier_mask |= bar->_mask;
-      // A barrier indicates to enforce the order of execution of streams
-      // (before, after, and bar itself) that have bit masks in common.
-      // If there are streams (either active or wait in FIFO) before
-      // this barrier are seperated by this barrier, this barrier should not retire.
-      if (bar->_mask & barred) {
-        DSA_LOG(BAR) << "Cannot retire because of prior streams.";
-        return;
-      }
-      // If there are active stream affected by this barrier,
-      // this barrier should not retire.
-      for (auto &i : accel->bsw.iports()) {
-        auto &in = accel->input_ports[i.port];
-        if (in.stream && (in.stream->barrier_mask() & bar->_mask)) {
-          DSA_LOG(BAR) << "Cannot retire because of active streams.";
-          return;
-        }
-      }
-      for (auto &i : accel->bsw.oports()) {
-        auto &out = accel->output_ports[i.port];
-        if (out.stream && (out.stream->barrier_mask() & bar->_mask)) {
-          DSA_LOG(BAR) << "Cannot retire because of active streams.";
-          return;
-        }
-      }
-      // If no stream is affected by this barrier, retire.
-      retire = true;
-    }
-
-    /*!
-     * \brief Schedule the read stream.
-     */
-    void Visit(IPortStream *ips) override {
-      barred |= ips->barrier_mask();
-      // (not blocked by barrier) && (input ports available)
-      retire = !(ips->barrier_mask() & barrier_mask) && IVPAvailable(ips->pes);
-      std::for_each(ips->pes.begin(), ips->pes.end(),
-                    [this] (const PortExecState &pes) { iports.push_back(pes.port); });
-    }
-
-    /*!
-     * \brief Schedule the write stream.
-     */
-    void Visit(OPortStream *ops) override {
-      barred |= ops->barrier_mask();
-      // (not blocked by barrier) && (output ports available)
-      retire = !(ops->barrier_mask() & barrier_mask) && OVPAvailable(ops->oports());
-      oports.insert(oports.end(), ops->oports().begin(), ops->oports().end());
-    }
-
-    /*!
-     * \brief Schedule a port to port stream.
-     */
-    void Visit(PortPortStream *pps) override {
-      barred |= pps->barrier_mask();
-      // (not blocked by barrier) && (output ports available) && (input ports available)
-      retire = !(pps->barrier_mask() & barrier_mask) &&
-               OVPAvailable(pps->oports) &&
-               IVPAvailable(pps->pes);
-      std::for_each(pps->pes.begin(), pps->pes.end(),
-                    [this] (const PortExecState &pes) { iports.push_back(pes.port); });
-      oports.insert(oports.end(), pps->oports.begin(), pps->oports.end());
-    }
-
-    /*!
-     * \brief Reset the status after each scheduling.
-     */
-    void Reset() {
-      retire = false;
-    }
-
-    /*!
-     * \brief The mask of blocking.
-     */
-    uint64_t barrier_mask{0};
-    /*!
-     * \brief This accelerator.
-     */
-    accel_t *accel;
-    /*!
-     * \brief If this scheduled instruction should be removed from the FIFO.
-     */
-    bool retire{false};
-    /*!
-     * \brief The barrier scoreboard.
-     */
-    uint64_t barred{0};
-    /*!
-     * \brief The ports occupied by prior streams. For example, both indirect streams
-              and port-port streams involve both input and output ports. These stream
-              can only be scheduled when both input and output ports are available.
-              Partial avaiability may affect the port-enforced stream order.
-     */
-    std::vector<int> iports, oports;
-  };
-
-  struct StreamDispatcher : dsa::sim::stream::Functor {
-    StreamDispatcher(accel_t *accel_) : accel(accel_) {}
-
-    /*!
-     * \brief Update the status of ports involved by the scheduled stream.
-     * \param is The scheduled stream.
-     */
-    void BindStreamToPorts(const vector<PortExecState> &pes, base_stream_t *stream) {
-      for (auto &elem : pes) {
-        auto &ivp = accel->input_ports[elem.port];
-        ivp.bindStream(stream);
-        ivp.pes = elem;
-      }
-    }
-  
-    void BindStreamToPorts(const vector<int> &ports, base_stream_t *stream) {
-      for (auto &elem : ports) {
-        accel->output_ports[elem].bindStream(stream);
-      }
-    }
-
-    void debugLog(base_stream_t *s0, base_stream_t *s1) {
-      DSA_LOG(DISPATCH)
-        << "[" << accel->get_ssim()->CurrentCycle() << "]: [" << s0
-        << "] Issue to Accel" << accel->accel_index() << " " << s1->toString();
-    }
-
-    /*!
-     * \brief Schedule the read stream.
-     */
-    void Visit(IPortStream *ips) override {
-      auto cloned = ips->clone(accel);
-      BindStreamToPorts(cloned->pes, cloned);
-      debugLog(ips, cloned);
-    }
-
-    /*!
-     * \brief .
-     */
-    void Visit(LinearReadStream *lrs) override {
-      // if (auto *l2d = dynamic_cast<Linear2D*>(lrs->ls)) {
-      //   if (lrs->pes.size() == 1 && !lrs->be) {
-      //     auto &pes = lrs->pes[0];
-      //     if (l2d->init.stride == 1) {
-      //       if (l2d->stride < accel->input_ports[pes.port].vectorLanes() &&
-      //           l2d->init.length == accel->input_ports[pes.port].vectorLanes()) {
-      //         DSA_INFO << l2d->toString();
-      //         int shift = l2d->init.length - l2d->stride;
-      //         auto *l1d = new Linear1D(l2d->init.word, l2d->init.start, l2d->init.stride,
-      //                                  l2d->length + shift, l2d->is_mem);
-      //         auto *cloned =
-      //           new LinearReadStream(lrs->unit(), lrs->context, l1d, lrs->pes, lrs->padding);
-      //         cloned->dtype = lrs->ls->word_bytes();
-      //         cloned->inst = lrs->inst;
-      //         auto *input = dynamic_cast<dfg::InputPort*>(accel->input_ports[pes.port].vp);
-      //         // TODO(@were): This is a broken feature. Migrate this to DFG frontend.
-      //         input->stationary_shift = l2d->stride;
-      //         DSA_INFO << cloned->toString();
-      //         BindStreamToPorts(cloned->pes, cloned);
-      //         return;
-      //       }
-      //     }
-      //   }
-      // }
-      Visit(static_cast<IPortStream*>(lrs));
-    }
-
-    /*!
-     * \brief Schedule the write stream.
-     */
-    void Visit(OPortStream *ops) override {
-      auto cloned = ops->clone(accel);
-      BindStreamToPorts(ops->oports(), cloned);
-      debugLog(ops, cloned);
-    }
-
-    /*!
-     * \brief Schedule a port to port stream.
-     */
-    void Visit(PortPortStream *pps) override {
-      auto cloned = pps->clone(accel);
-      BindStreamToPorts(pps->pes, cloned);
-      for (auto elem : pps->oports) {
-        auto &out = accel->output_ports[elem];
-        out.bindStream(cloned);
-      }
-      debugLog(pps, cloned);
-    }
-
-    /*!
-     * \brief This accelerator.
-     */
-    accel_t *accel;
-  };
-
-  std::vector<DispatchChecker> dc;
-  std::vector<StreamDispatcher> sd;
-
-  for (int i = 0; i < lanes.size(); ++i) {
-    dc.emplace_back(lanes[i]);
-    sd.emplace_back(lanes[i]);
-  }
-
-  DSA_LOG(DISPATCH) << cmd_queue.size() << " streams to be dispatched!";
-  for (int i = 0; i < (int) cmd_queue.size(); ++i) {
-    bool retire = true;
-    if (cmd_queue[i]->stream_active()) {
-      for (int j = 0; j < (int) lanes.size(); ++j) {
-        if (cmd_queue[i]->context >> j & 1) {
-          cmd_queue[i]->Accept(&dc[j]);
-          retire = retire && dc[j].retire;
-          if (!retire) {
-            DSA_LOG(CMD_BLOCK) << "Cannot Issue Stream: " << cmd_queue[i]->toString();
-            break;
-          }
-        }
-      }
-      if (retire) {
-        for (int j = 0; j < (int) lanes.size(); ++j) {
-          if (cmd_queue[i]->context >> j & 1) {
-            cmd_queue[i]->Accept(&sd[j]);
-          }
-        }
-      }
-      for (int j = 0; j < (int) lanes.size(); ++j) {
-        if (cmd_queue[i]->context >> j & 1) {
-          dc[j].Reset();
-        }
-      }
-    }
-    if (retire) {
-      cmd_queue.erase(cmd_queue.begin() + i);
-      --i;
-    }
-  }
-
+  _dispatcher->Dispatch();
 }
 
 //The reroute function handles either local recurrence, or remote data transfer
@@ -595,6 +369,7 @@ void ssim_t::Reroute(int oport, int iport) {
 
 // receive network message at the given input port id
 void ssim_t::push_in_accel_port(int accel_id, int8_t* val, int num_bytes, int in_port) {
+  WakeUp();
   assert(accel_id < lanes.size() && accel_id >= 0);
   lanes[accel_id]->receive_message(val, num_bytes, in_port);
 }
@@ -605,10 +380,12 @@ void ssim_t::push_atomic_update_req(int scr_addr, int opcode, int val_bytes, int
 }
 
 void ssim_t::push_ind_rem_read_req(bool is_remote, int req_core, int request_ptr, int addr, int data_bytes, int reorder_entry) {
+    WakeUp();
     lanes[0]->push_ind_rem_read_req(is_remote, req_core, request_ptr, addr, data_bytes, reorder_entry);
 }
 
 void ssim_t::push_ind_rem_read_data(int8_t* data, int request_ptr, int addr, int data_bytes, int reorder_entry) {
+    WakeUp();
     lanes[0]->push_ind_rem_read_data(data, request_ptr, addr, data_bytes, reorder_entry);
 }
 
@@ -636,23 +413,243 @@ bool ssim_t::is_in_config() {
   return false;
 }
 
+bool ssim_t::drained() {
+  if (!cmd_queue.empty() || !bes.empty() || is_in_config()) {
+    return false;
+  }
+  for (auto *lane : lanes) {
+    if (!lane->done_internal(false, -1) || !lane->done(false, -1)) {
+      return false;
+    }
+    for (auto &spad : lane->spads) {
+      if (spad.rb->Active()) {
+        return false;
+      }
+    }
+    if (lane->prefetcher && lane->prefetcher->in_flight()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ssim_t::serialize(CheckpointOut &cp) const {
+  DSA_CHECK(cmd_queue.empty() && bes.empty()) << "Drain the lanes before checkpointing!";
+  for (int i = 0; i < DSARF::TOTAL_REG; ++i) {
+    paramOut(cp, csprintf("rf.%s", REG_NAMES[i]), rf[i].value);
+    paramOut(cp, csprintf("rf.%s.sticky", REG_NAMES[i]), rf[i].sticky);
+  }
+  std::vector<int64_t> broadcast, repeat, stretch;
+  for (auto &elem : vps) {
+    broadcast.push_back(elem.broadcast);
+    repeat.push_back(elem.repeat);
+    stretch.push_back(elem.stretch);
+  }
+  SERIALIZE_CONTAINER(broadcast);
+  SERIALIZE_CONTAINER(repeat);
+  SERIALIZE_CONTAINER(stretch);
+  SERIALIZE_SCALAR(_in_use);
+  SERIALIZE_SCALAR(_ever_used_bitmask);
+  statistics.serialize(cp);
+  for (int i = 0; i < (int) lanes.size(); ++i) {
+    lanes[i]->serializeSection(cp, csprintf("lane%d", i));
+  }
+}
+
+void ssim_t::unserialize(CheckpointIn &cp) {
+  for (int i = 0; i < DSARF::TOTAL_REG; ++i) {
+    paramIn(cp, csprintf("rf.%s", REG_NAMES[i]), rf[i].value);
+    paramIn(cp, csprintf("rf.%s.sticky", REG_NAMES[i]), rf[i].sticky);
+  }
+  std::vector<int64_t> broadcast, repeat, stretch;
+  UNSERIALIZE_CONTAINER(broadcast);
+  UNSERIALIZE_CONTAINER(repeat);
+  UNSERIALIZE_CONTAINER(stretch);
+  DSA_CHECK(broadcast.size() == DSA_MAX_PORTS && repeat.size() == DSA_MAX_PORTS &&
+            stretch.size() == DSA_MAX_PORTS)
+    << "The ports differ from the checkpoint!";
+  for (int i = 0; i < DSA_MAX_PORTS; ++i) {
+    vps[i].broadcast = broadcast[i];
+    vps[i].repeat = repeat[i];
+    vps[i].stretch = stretch[i];
+  }
+  UNSERIALIZE_SCALAR(_in_use);
+  UNSERIALIZE_SCALAR(_ever_used_bitmask);
+  statistics.unserialize(cp);
+  for (int i = 0; i < (int) lanes.size(); ++i) {
+    lanes[i]->unserializeSection(cp, csprintf("lane%d", i));
+  }
+}
+
 void ssim_t::cycle_shared_busses() {
 }
 
 void ssim_t::step() {
+  DrainPrefetches();
   if (!_in_use) {
     return;
   }
   cycle_shared_busses();
   DispatchStream();
+  SampleTimeline();
+  if (_lane_pool && ParallelLanes()) {
+    StepParallel();
+    return;
+  }
   for(int i = 0; i < (int) (lanes.size() - 1); ++i) {
     if(_ever_used_bitmask >> i & 1) {
+      if (lanes[i]->quiescent) {
+        if (!lanes[i]->shouldWakeUp()) {
+          lanes[i]->skipCycle();
+          continue;
+        }
+        lanes[i]->wakeUp();
+      }
       lanes[i]->tick();
+      lanes[i]->quiescent = lanes[i]->checkQuiescence();
     }
   }
   // shared_acc()->tick();
 }
 
+void ssim_t::SampleTimeline() {
+  if (spec.timeline_interval <= 0 || !in_roi()) {
+    return;
+  }
+  if (++_timeline_cycles < spec.timeline_interval) {
+    return;
+  }
+  _timeline_cycles = 0;
+  std::ostream *csv = timeline.is_open() ? &timeline : nullptr;
+  if (csv && !_timeline_header) {
+    // The lanes share the ports of the same ADG.
+    timeline << "cycle,lane,dma_reads,dma_writes";
+    for (int i = 0; i < (int) lanes[0]->input_ports.size(); ++i) {
+      timeline << ",port" << i << "_bytes";
+    }
+    timeline << "\n";
+    _timeline_header = true;
+  }
+  for (int i = 0; i < (int) (lanes.size() - 1); ++i) {
+    if (_ever_used_bitmask >> i & 1) {
+      lanes[i]->statistics.sampleTimeline(csv);
+    }
+  }
+}
+
+void ssim_t::DrainPrefetches() {
+  while (const auto *response = lsq()->findResponse(SS_PREFETCH_QUEUE)) {
+    lanes[response->sdInfo->which_accel]->prefetcher->Complete();
+    lsq()->popResponse(SS_PREFETCH_QUEUE);
+  }
+}
+
+bool ssim_t::ParallelLanes() {
+  // Configuring and resetting a lane, and the network, touch the other lanes within tickIssue().
+  if (lsq()->findResponse(CONFIG_STREAM) || !lsq()->is_pending_net_empty()) {
+    return false;
+  }
+  int ticking = 0;
+  for (int i = 0; i < (int) (lanes.size() - 1); ++i) {
+    if (_ever_used_bitmask >> i & 1) {
+      auto *lane = lanes[i];
+      if (lane->_cleanup_mode || lane->_stream_cleanup_mode) {
+        return false;
+      }
+      ticking += !lane->quiescent;
+    }
+  }
+  return ticking > 1;
+}
+
+void ssim_t::StepParallel() {
+  // The lanes only interact in tickIssue() and tickRetire(), which are still done in the
+  // order of lanes. cycle_cgra() only touches its own lane, so moving all of them
+  // in between gives the same results as ticking the lanes one by one.
+  _ticking.clear();
+  for (int i = 0; i < (int) (lanes.size() - 1); ++i) {
+    if (_ever_used_bitmask >> i & 1) {
+      if (lanes[i]->quiescent) {
+        if (!lanes[i]->shouldWakeUp()) {
+          lanes[i]->skipCycle();
+          continue;
+        }
+        lanes[i]->wakeUp();
+      }
+      lanes[i]->tickIssue();
+      _ticking.push_back(lanes[i]);
+    }
+  }
+  _lane_pool->Run(_ticking.size(), [this] (int i) { _ticking[i]->cycle_cgra(); });
+  for (auto *lane : _ticking) {
+    lane->tickRetire();
+    lane->quiescent = lane->checkQuiescence();
+  }
+}
+
+void ssim_t::WakeUp() {
+  for (auto *lane : lanes) {
+    if (lane->quiescent) {
+      lane->wakeUp();
+    }
+  }
+}
+
+void ssim_t::FastForward(PortProxy &proxy) {
+  if (!spec.fast_forward || _functional || _times_roi_entered || !drained()) {
+    return;
+  }
+  DSA_LOG(ROI) << now() << ": Functional execution until the ROI";
+  _functional.reset(new dsa::sim::FunctionalMemory(lsq_, proxy));
+  lsq_ = _functional.get();
+}
+
+void ssim_t::RunFunctional() {
+  WakeUp();
+  auto start = std::chrono::steady_clock::now();
+  auto period = lsq()->clockPeriod();
+  auto progress = forward_progress_cycle();
+  auto requests = _functional->requests;
+  int idle = 0;
+  while (_in_use && !drained() && idle < spec.fast_forward_idle) {
+    _functional_ticks += period;
+    ++_functional_cycles;
+    step();
+    if (forward_progress_cycle() != progress || _functional->requests != requests) {
+      progress = forward_progress_cycle();
+      requests = _functional->requests;
+      idle = 0;
+    } else {
+      ++idle;
+    }
+  }
+  _functional_seconds +=
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ssim_t::SwitchToTimed() {
+  RunFunctional();
+  DSA_CHECK(drained()) << "The streams should be done before the ROI to switch to the timed lanes!";
+  _functional_requests = _functional->requests;
+  DSA_LOG(ROI) << now() << ": Timed execution from the ROI, "
+               << _functional_requests << " requests served functionally";
+  lsq_ = _functional->timed;
+  _functional.reset();
+  // The time of the lanes falls back to that of the host, so the timestamps taken in the
+  // functional runs, which are ahead of it, are dropped.
+  for (auto *lane : lanes) {
+    lane->forward_progress();
+    if (lane->prefetcher) {
+      lane->prefetcher->Reset();
+    }
+  }
+  WakeUp();
+}
+
+void ssim_t::exportStats(Stats::Group *parent) {
+  _gem5_stats.reset(new dsa::stat::HostStats(parent, *this));
+}
+
 void ssim_t::print_stats() {
   auto& out = std::cout;
   out.precision(4);
@@ -660,6 +657,13 @@ void ssim_t::print_stats() {
 
   out << "\n*** ROI STATISTICS for CORE ID: " << lsq()->getCpuId() << " ***\n";
   out << "Simulator Time: " << statistics.timeElapsed() << " seconds" << std::endl;
+  if (_functional_cycles) {
+    // Compare the lane cycles a second with those of the ROI to tell the speedup.
+    out << "Fast-Forward: " << _functional_cycles << " lane cycles, " << _functional_requests
+        << " functional requests in " << _functional_seconds << " seconds ("
+        << _functional_cycles / std::max(_functional_seconds, 1e-9) << " cycles/s, ROI: "
+        << statistics.cycleElapsed() / std::max(statistics.timeElapsed(), 1e-9) << " cycles/s)\n";
+  }
 
   out << "Cycles: " << (int) statistics.cycleElapsed() << "\n";
   out << "Number of coalesced SPU requests: " << lanes[0]->_stat_num_spu_req_coalesced << "\n";
@@ -803,6 +807,7 @@ void ssim_t::timestamp_context() {
 
 // it is not a stream; just a linear write (just push data into buf?)
 void ssim_t::write_remote_banked_scratchpad(uint8_t* val, int num_bytes, uint16_t scr_addr) {
+  WakeUp();
   // TODO: add a check for full buffer to apply backpressure to network
   lanes[0]->push_scratch_remote_buf(val, num_bytes, scr_addr); // hopefully, we use single accel per CC
 }
@@ -902,6 +907,9 @@ bool ssim_t::CanReceive(int imm) {
 
 //These two functions just return the first core from 0
 bool ssim_t::CanReceive(int port, int dtype) {
+  if (Functional()) {
+    RunFunctional();
+  }
   auto context = rf[DSARF::TBC].value;
   DSA_CHECK((context & -context) == context)
     << "More than one accelerator to receive!";
@@ -934,11 +942,10 @@ uint64_t ssim_t::Receive(int port) {
   for (int i = 0; i < (int) lanes.size(); ++i) {
     if(context >> i & 1) {
       auto &ovp = lanes[i]->output_ports[port];
-      std::vector<uint8_t> raw(ovp.raw.begin(), ovp.raw.begin() + dtype);
+      DSA_CHECK(dtype <= 8);
+      uint64_t res = 0;
+      ovp.peek(reinterpret_cast<uint8_t*>(&res), dtype);
       ovp.pop(dtype);
-      DSA_CHECK(raw.size() <= 8);
-      raw.resize(8, 0);
-      auto res = *reinterpret_cast<uint64_t*>(&raw[0]);
       DSA_LOG(RECV)
         << now() << " SS_RECV value: " << res
         << " on port" << ovp.id() << " " << ovp.raw.size()
@@ -953,6 +960,15 @@ uint64_t ssim_t::Receive(int port) {
 void ssim_t::InsertBarrier(uint64_t mask) {
   Barrier* s = new Barrier(rf[DSARF::TBC].value, mask);
   s->set_orig();
+  // The barrier only orders the streams of the lanes it is issued to. Their records are
+  // dropped when the lanes retire it, see accel_t::tickRetire.
+  for (int i = 0; i < (int) lanes.size(); ++i) {
+    if (auto *race = lanes[i]->race.get()) {
+      if (s->context >> i & 1) {
+        race->Barrier(s->id(), mask);
+      }
+    }
+  }
   // BroadcastStream(s);
 }
 
@@ -969,20 +985,32 @@ void ssim_t::insert_df_barrier(int64_t num_scr_wr, bool spad_type) {
 }
 
 uint64_t ssim_t::now() {
-  return curTick(); //lsq()->get_cpu().curCycle();
+  // The functional runs tick the lanes without the host, so the lanes see their own time
+  // until they switch to the timed memory, and that of the host afterwards.
+  return Functional() ? curTick() + _functional_ticks : curTick(); //lsq()->get_cpu().curCycle();
 }
 
 void ssim_t::update_stat_cycle() {
+  update_stat_cycle(now());
+}
+
+void ssim_t::update_stat_cycle(uint64_t cycle) {
   assert(in_roi());
   if (_stat_start_cycle == ~0ull) {
-    _stat_start_cycle = now();
+    _stat_start_cycle = cycle;
   } else {
-    _stat_stop_cycle = now();
+    _stat_stop_cycle = cycle;
   }
 }
 
 // ------------------------- TIMING ---------------------------------
 void ssim_t::roi_entry(bool enter) {
+  if (enter && Functional()) {
+    SwitchToTimed();
+  }
+  if (trace) {
+    trace->Roi(now(), enter);
+  }
   if(enter) {
     if(_orig_stat_start_cycle == 0) {
       _orig_stat_start_cycle = now();
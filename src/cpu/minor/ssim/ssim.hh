@@ -3,12 +3,19 @@
 
 #include <time.h>
 #include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include "./accel.hh"
+#include "./dispatcher.h"
 #include "./port.h"
 #include "./spec.h"
 #include "./statistics.h"
+#include "./lane_pool.h"
+#include "./gem5_stats.h"
+#include "./memory.h"
 #include "dsa-ext/spec.h"
+#include "sim/serialize.hh"
 
 #include <string>
 
@@ -22,6 +29,8 @@ struct Specification {
 
 }
 
+struct MinorCPUParams;
+
 namespace Minor {
 
 class ExecContext;
@@ -35,7 +44,7 @@ static void rolling_inc(T& which, S max, R reset) {
 }
 
 
-class ssim_t {
+class ssim_t : public Serializable {
   friend class scratch_read_controller_t;
   friend class scratch_write_controller_t;
   friend class network_controller_t;
@@ -44,12 +53,21 @@ class ssim_t {
 
 public:
 
-  ssim_t(Minor::LSQ *lsq_);
+  /*!
+   * \brief Build the simulator of the accelerator lanes attached to this core.
+   * \param params The MinorCPU parameters overriding the default spec,
+   *        which are overridden by $DSA_SPEC in turn.
+   */
+  ssim_t(Minor::LSQ *lsq_, const MinorCPUParams &params);
+  /*!
+   * \brief Build the simulator upon the given memory system, e.g. a mock memory.
+   */
+  ssim_t(dsa::sim::MemoryInterface *lsq_, const MinorCPUParams &params);
 
   uint64_t roi_enter_cycle() { return _roi_enter_cycle; }
 
-  /*! \brief The execute context to which this dsa belongs. */
-  Minor::LSQ *lsq_{nullptr};
+  /*! \brief The memory system to which this dsa belongs. */
+  dsa::sim::MemoryInterface *lsq_{nullptr};
 
   /*! \brief The register file of the CGRA status. */
   dsa::sim::ConfigState rf[DSARF::TOTAL_REG];
@@ -66,6 +84,12 @@ public:
   /*! \brief The array of spatial lanes. */
   std::vector<accel_t*> lanes;
 
+  /*! \brief The binary trace of stream lifetimes, if $DSA_SPEC gives a trace_file. */
+  std::unique_ptr<dsa::sim::TraceSink> trace;
+
+  /*! \brief The CSV of the sampled timeline, if $DSA_SPEC gives a timeline_file. */
+  std::ofstream timeline;
+
   /*!
    * \brief Count the execution status.
    */
@@ -174,9 +198,9 @@ public:
   void resetNonStickyState();
 
   /*!
-   * \brief Expose the affiliated DMA LSQ.
+   * \brief Expose the affiliated memory system.
    */
-  Minor::LSQ *lsq();
+  dsa::sim::MemoryInterface *lsq();
 
   /*! \brief If this port has enough value to pop. */
   bool CanReceive(int port, int dtype);
@@ -276,11 +300,27 @@ public:
 
 
   void print_stats();
+  /*!
+   * \brief Register the statistics of the host controller and the lanes
+   *        under the given gem5 statistics group.
+   */
+  void exportStats(Stats::Group *parent);
   uint64_t forward_progress_cycle();
   void forward_progress(uint64_t c) {_global_progress_cycle=c;}
   void set_memory_map_config(base_stream_t* s, uint64_t partition_size, uint64_t active_core_bitvector, int mapping_type);
   bool done(bool show, int mask);
   bool is_in_config();
+  /*!
+   * \brief If no command, stream, data, or configuration is in flight in any lane,
+   *        so that the state of the lanes can be checkpointed.
+   */
+  bool drained();
+
+  /*!
+   * \brief Checkpoint the registers, the port states, and the lanes. It should be drained.
+   */
+  void serialize(CheckpointOut &cp) const override;
+  void unserialize(CheckpointIn &cp) override;
 
   // do not want to stall the control core
   void insert_df_barrier(int64_t num_scr_wr, bool spad_type);
@@ -305,6 +345,7 @@ public:
   /* After entering the ROI, updates the status of starting and ending cycle so that
    * we can ignore those "white bubbles". */
   void update_stat_cycle();
+  void update_stat_cycle(uint64_t cycle);
 
   // TODO(@were): Deprecate this!
   void timestamp(); //print timestamp
@@ -313,6 +354,47 @@ public:
 
   void step();
   void cycle_shared_busses();
+  /*!
+   * \brief Retire the stream prefetches responded. Their transfer queue is shared by the
+   *        lanes, which may be quiescent, so it is drained before the lanes tick.
+   */
+  void DrainPrefetches();
+  /*!
+   * \brief Sample the timeline of the lanes every timeline_interval cycles in the ROI.
+   */
+  void SampleTimeline();
+  /*!
+   * \brief If the CGRAs of the lanes can be simulated in parallel this cycle.
+   */
+  bool ParallelLanes();
+  /*!
+   * \brief Tick the lanes, with their CGRAs simulated by the lane pool.
+   */
+  void StepParallel();
+
+  /*!
+   * \brief Wake up all the quiescent lanes, before the host changes their state.
+   */
+  void WakeUp();
+
+  /*!
+   * \brief Before the first ROI, if the spec asks for it, serve the memory requests of the
+   *        stream commands functionally upon the given accesses of the host thread from now on.
+   *        Only the memory side is functional: the lanes are still stepped cycle by cycle,
+   *        with their ports, arbiter, scratchpad banks and CGRA, only without the host.
+   */
+  void FastForward(PortProxy &proxy);
+  /*! \brief If the memory requests of the lanes are served functionally. */
+  bool Functional() { return _functional != nullptr; }
+  /*!
+   * \brief Step the lanes until they are drained, or nothing moves without the host.
+   *        The cycles stepped are not seen by the host.
+   */
+  void RunFunctional();
+  /*!
+   * \brief Finish the functional execution, and go back to the timed memory.
+   */
+  void SwitchToTimed();
 
   void issued_inst() {
     if(in_roi()) {
@@ -386,6 +468,36 @@ private:
 
   uint64_t _ever_used_bitmask=1; //bitmask if core ever used
 
+  /*! \brief The adapter of the host LSQ, if this simulator is built upon it. */
+  std::unique_ptr<dsa::sim::LSQMemory> _lsq_memory;
+  /*! \brief The memory serving the requests in the functional mode. */
+  std::unique_ptr<dsa::sim::FunctionalMemory> _functional;
+  /*!
+   * \brief The cycles ticked by the functional runs, in ticks, hidden from the host.
+   *        Only added to the time of the lanes while they are functional.
+   */
+  uint64_t _functional_ticks=0;
+  /*! \brief The lane cycles stepped, the requests served and the seconds spent functionally. */
+  int64_t _functional_cycles{0};
+  int64_t _functional_requests{0};
+  double _functional_seconds{0};
+
+  /*! \brief The dispatcher of the commands queued to the lanes. */
+  std::unique_ptr<dsa::sim::CommandDispatcher> _dispatcher;
+
+  /*! \brief The cycles since the last sample of the timeline. */
+  int64_t _timeline_cycles{0};
+  /*! \brief If the header of the timeline CSV is written. */
+  bool _timeline_header{false};
+
+  /*! \brief The workers of ticking lanes in parallel, if enabled. */
+  std::unique_ptr<dsa::sim::LanePool> _lane_pool;
+  /*! \brief The lanes ticked in this cycle, reused across cycles. */
+  std::vector<accel_t*> _ticking;
+
+  /*! \brief The statistics exported to gem5, if a statistics group is given. */
+  std::unique_ptr<dsa::stat::HostStats> _gem5_stats;
+
   int _num_active_threads=1; // -1; // for global barrier
 
   bool _prev_done = true;
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <numeric>
+
 #include "accel.hh"
 #include "ssim.hh"
 #include "statistics.h"
 
+#include "mem/ruby/protocol/MachineType.hh"
+
 namespace dsa {
 namespace stat {
 
@@ -48,7 +53,29 @@ double Host::cycleElapsed() {
 }
 
 double Host::cyclesImpl(int64_t x) {
-  return (double) x / parent.lsq()->get_cpu().clockDomain.clockPeriod();
+  return (double) x / parent.lsq()->clockPeriod();
+}
+
+void Host::serialize(CheckpointOut &cp) const {
+  SERIALIZE_SCALAR(insts_issued);
+  SERIALIZE_SCALAR(insts_discarded);
+  SERIALIZE_SCALAR(ctrl_instructions);
+  SERIALIZE_SCALAR(ctrl_intrinsics);
+  SERIALIZE_SCALAR(roi_);
+  SERIALIZE_ARRAY(sim_cycle, 2);
+}
+
+void Host::unserialize(CheckpointIn &cp) {
+  UNSERIALIZE_SCALAR(insts_issued);
+  UNSERIALIZE_SCALAR(insts_discarded);
+  UNSERIALIZE_SCALAR(ctrl_instructions);
+  UNSERIALIZE_SCALAR(ctrl_intrinsics);
+  UNSERIALIZE_SCALAR(roi_);
+  UNSERIALIZE_ARRAY(sim_cycle, 2);
+  if (roi_) {
+    // The wall time of the ROI restarts from the restoration.
+    gettimeofday(sim_time + 1, nullptr);
+  }
 }
 
 const char *Accelerator::BlameStr[] = {
@@ -57,8 +84,17 @@ const char *Accelerator::BlameStr[] = {
   #undef MACRO
 };
 
+const char *Accelerator::ServiceLevelStr[] = {
+  "L1", "REMOTE_L1", "L2", "MEMORY", "UNKNOWN",
+};
+
+const char *Accelerator::DispatchBlockStr[] = {
+  "PORT_BUSY", "BUFFER_NON_EMPTY", "BARRIER",
+};
+
 Accelerator::Accelerator(accel_t &parent_) : parent(parent_) {
   memset(blame_count, 0, sizeof(blame_count));
+  memset(dispatch_blocked, 0, sizeof(dispatch_blocked));
   memset(mem_lat_brkd, 0, sizeof(mem_lat_brkd));
 }
 
@@ -131,16 +167,224 @@ void Accelerator::blameCycle() {
     }
   }
   ++blame_count[blame];
+  if (auto *t = parent.tracer) {
+    t->Blame(parent.now(), parent.accel_index(), blame);
+  }
   DSA_LOG(BLAME)
     << parent.now() << " " << BlameStr[blame] << ": " << (sb ? sb->toString() : "(null)")
     << ", Active Out: " << io_cnt[0] << ", Active In: " << io_cnt[1];
 }
 
-void Accelerator::countMemoryLatency(int64_t request_cycle, int64_t *breakdown) {
+void Accelerator::blameSkippedCycles(int64_t cycles) {
+  if (!roi()) {
+    return;
+  }
+  blame_count[blame] += cycles;
+  DSA_LOG(BLAME) << parent.now() << " " << BlameStr[blame] << ": " << cycles << " skipped cycles";
+}
+
+int Log2Histogram::bucketOf(int64_t value) {
+  int bucket = 0;
+  while (value > 0 && bucket < NUM_BUCKETS - 1) {
+    value >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+int64_t Log2Histogram::bucketMax(int bucket) {
+  return bucket ? (int64_t(1) << bucket) - 1 : 0;
+}
+
+int64_t Log2Histogram::percentile(const double *buckets, int n, double p) {
+  double total = 0;
+  for (int i = 0; i < n; ++i) {
+    total += buckets[i];
+  }
+  double acc = 0;
+  for (int i = 0; i < n; ++i) {
+    acc += buckets[i];
+    if (buckets[i] && acc >= p * total) {
+      return bucketMax(i);
+    }
+  }
+  return 0;
+}
+
+void Log2Histogram::add(int64_t value) {
+  ++buckets[bucketOf(value)];
+  ++count;
+  sum += value;
+  max = std::max(max, value);
+}
+
+int64_t Log2Histogram::percentile(double p) const {
+  double values[NUM_BUCKETS];
+  std::copy(buckets, buckets + NUM_BUCKETS, values);
+  return std::min(max, percentile(values, NUM_BUCKETS, p));
+}
+
+void Accelerator::countMemoryLatency(int64_t request_cycle, int64_t *breakdown,
+                                     int stream_id, int port) {
   if (roi()) {
+    int64_t cycles = (parent.now() - request_cycle) / parent.freq();
+    latency_histo.add(cycles);
+    stream_latency[stream_id].add(cycles);
+    port_latency[port].add(cycles);
     memory_latency += parent.now() - request_cycle;
     for (int i = 0; i < 11; ++i) {
-      mem_lat_brkd[i] += (parent.now() - breakdown[i]);
+      // The states a request skips are never entered.
+      if (breakdown[i] != -1) {
+        mem_lat_brkd[i] += (parent.now() - breakdown[i]);
+      }
+    }
+  }
+}
+
+void Accelerator::blockDispatch(DispatchBlock reason) {
+  if (roi()) {
+    ++dispatch_blocked[reason];
+  }
+}
+
+void Accelerator::sampleTimeline(std::ostream *csv) {
+  int64_t reads = parent.dma_c()->mem_read_reqs();
+  outstanding_reads.add(reads);
+  // Only the ports mapped by the DFG are bound, the rest of the ADG ports buffer nothing.
+  std::vector<int> bytes(parent.input_ports.size(), 0);
+  for (auto &port : parent.bsw.iports()) {
+    bytes[port.port] = parent.input_ports[port.port].bytesBuffered();
+  }
+  port_occupancy.resize(bytes.size(), 0);
+  for (int i = 0; i < (int) bytes.size(); ++i) {
+    port_occupancy[i] += bytes[i];
+  }
+  if (csv) {
+    *csv << parent.now() / parent.freq() << "," << parent.accel_index() << "," << reads << ","
+         << parent.dma_c()->mem_write_reqs();
+    for (auto elem : bytes) {
+      *csv << "," << elem;
+    }
+    *csv << "\n";
+  }
+}
+
+namespace {
+
+/*!
+ * \brief Move the entry of the stream into the kept ones, if it is among the n of the largest key.
+ */
+template<typename T, typename F>
+void keepLargest(std::unordered_map<int, T> &inflight, std::vector<std::pair<int, T>> &kept,
+                 int n, int stream_id, F key) {
+  auto iter = inflight.find(stream_id);
+  if (iter == inflight.end()) {
+    return;
+  }
+  if ((int) kept.size() < n) {
+    kept.emplace_back(stream_id, iter->second);
+  } else {
+    auto least = std::min_element(kept.begin(), kept.end(),
+                                  [&key] (const std::pair<int, T> &a, const std::pair<int, T> &b) {
+                                    return key(a.second) < key(b.second);
+                                  });
+    if (key(least->second) < key(iter->second)) {
+      *least = std::make_pair(stream_id, iter->second);
+    }
+  }
+  inflight.erase(iter);
+}
+
+/*!
+ * \brief The n entries of the largest key among the kept and those in flight, the largest first.
+ */
+template<typename T, typename F>
+std::vector<std::pair<int, const T*>> largestOf(const std::unordered_map<int, T> &inflight,
+                                                const std::vector<std::pair<int, T>> &kept,
+                                                int n, F key) {
+  std::vector<std::pair<int, const T*>> res;
+  for (auto &elem : kept) {
+    res.emplace_back(elem.first, &elem.second);
+  }
+  for (auto &elem : inflight) {
+    res.emplace_back(elem.first, &elem.second);
+  }
+  std::sort(res.begin(), res.end(),
+            [&key] (const std::pair<int, const T*> &a, const std::pair<int, const T*> &b) {
+              return key(*a.second) > key(*b.second);
+            });
+  if ((int) res.size() > n) {
+    res.resize(n);
+  }
+  return res;
+}
+
+int64_t p99(const Log2Histogram &h) {
+  return h.percentile(0.99);
+}
+
+int64_t reads(const Accelerator::Service &s) {
+  return s.reads();
+}
+
+}
+
+void Accelerator::retireStream(int stream_id) {
+  keepLargest(stream_latency, worst_stream_latency, WORST_STREAMS, stream_id, p99);
+  keepLargest(stream_service, busiest_stream_service, WORST_STREAMS, stream_id, reads);
+}
+
+std::vector<std::pair<int, const Log2Histogram*>> Accelerator::worstStreams() const {
+  return largestOf(stream_latency, worst_stream_latency, WORST_STREAMS, p99);
+}
+
+std::vector<std::pair<int, const Accelerator::Service*>> Accelerator::busiestStreams() const {
+  return largestOf(stream_service, busiest_stream_service, WORST_STREAMS, reads);
+}
+
+int64_t Accelerator::Service::reads() const {
+  return std::accumulate(requests, requests + NUM_SERVICE_LEVELS, int64_t(0));
+}
+
+Accelerator::ServiceLevel Accelerator::serviceLevel(const Request::ServiceInfo &info) {
+  if (info.machine == -1) {
+    return UNKNOWN_LEVEL;
+  }
+  if (!info.external) {
+    return L1;
+  }
+  // The machines differ among the protocols, so they are told by the names.
+  static const std::vector<ServiceLevel> levels = [] () {
+    std::vector<ServiceLevel> res(MachineType_NUM, MEMORY);
+    for (int i = 0; i < MachineType_NUM; ++i) {
+      std::string name = MachineType_to_string((MachineType) i);
+      if (name == "L0Cache" || name == "L1Cache") {
+        res[i] = REMOTE_L1;
+      } else if (name == "L2Cache" || name == "L3Cache") {
+        res[i] = L2;
+      }
+    }
+    return res;
+  }();
+  DSA_CHECK(info.machine >= 0 && info.machine < (int) levels.size()) << info.machine;
+  return levels[info.machine];
+}
+
+void Accelerator::countService(LOC unit, int stream_id, const Request::ServiceInfo &info) {
+  if (!roi()) {
+    return;
+  }
+  auto period = parent.freq();
+  auto level = serviceLevel(info);
+  for (auto *s : {&service[unit], &stream_service[stream_id]}) {
+    ++s->requests[level];
+    s->latency[level] += info.totalDelay / period;
+    s->merged += info.merged;
+    if (info.breakdown) {
+      ++s->broken_down;
+      s->issue_delay += info.issueDelay / period;
+      s->forward_delay += info.forwardDelay / period;
+      s->response_delay += info.responseDelay / period;
     }
   }
 }
@@ -159,6 +403,92 @@ double Accelerator::averageImpl(int64_t value) {
   return res / norm;
 }
 
+void Accelerator::serialize(CheckpointOut &cp) const {
+  SERIALIZE_SCALAR(commands_issued);
+  SERIALIZE_SCALAR(instance_cnt);
+  SERIALIZE_SCALAR(dynamic_instructions);
+  SERIALIZE_ARRAY(blame_count, Blame::UNKNOWN + 1);
+  SERIALIZE_ARRAY(dispatch_blocked, NUM_DISPATCH_BLOCKS);
+  std::vector<int64_t> requests, bytes;
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < LOC::TOTAL; ++j) {
+      requests.push_back(traffic[i][j].num_requests);
+      bytes.push_back(traffic[i][j].traffic);
+    }
+  }
+  SERIALIZE_CONTAINER(requests);
+  SERIALIZE_CONTAINER(bytes);
+  SERIALIZE_SCALAR(memory_latency);
+  SERIALIZE_ARRAY(mem_lat_brkd, 11);
+  SERIALIZE_SCALAR(write_unit_bubble);
+  // The services of the streams are not kept, for the stream IDs restart.
+  std::vector<int64_t> services;
+  for (auto &elem : service) {
+    services.insert(services.end(), elem.requests, elem.requests + NUM_SERVICE_LEVELS);
+    services.insert(services.end(), elem.latency, elem.latency + NUM_SERVICE_LEVELS);
+    services.insert(services.end(), {elem.merged, elem.broken_down, elem.issue_delay,
+                                     elem.forward_delay, elem.response_delay});
+  }
+  SERIALIZE_CONTAINER(services);
+  // The distributions of the streams and ports are not kept, the same as the services.
+  std::vector<int64_t> histograms;
+  for (auto *elem : {&latency_histo, &outstanding_reads}) {
+    histograms.insert(histograms.end(), elem->buckets, elem->buckets + Log2Histogram::NUM_BUCKETS);
+    histograms.insert(histograms.end(), {elem->count, elem->sum, elem->max});
+  }
+  SERIALIZE_CONTAINER(histograms);
+}
+
+void Accelerator::unserialize(CheckpointIn &cp) {
+  UNSERIALIZE_SCALAR(commands_issued);
+  UNSERIALIZE_SCALAR(instance_cnt);
+  UNSERIALIZE_SCALAR(dynamic_instructions);
+  UNSERIALIZE_ARRAY(blame_count, Blame::UNKNOWN + 1);
+  UNSERIALIZE_ARRAY(dispatch_blocked, NUM_DISPATCH_BLOCKS);
+  std::vector<int64_t> requests, bytes;
+  UNSERIALIZE_CONTAINER(requests);
+  UNSERIALIZE_CONTAINER(bytes);
+  DSA_CHECK((int) requests.size() == 2 * LOC::TOTAL && (int) bytes.size() == 2 * LOC::TOTAL)
+    << "The memory units differ from the checkpoint!";
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < LOC::TOTAL; ++j) {
+      traffic[i][j].num_requests = requests[i * LOC::TOTAL + j];
+      traffic[i][j].traffic = bytes[i * LOC::TOTAL + j];
+    }
+  }
+  UNSERIALIZE_SCALAR(memory_latency);
+  UNSERIALIZE_ARRAY(mem_lat_brkd, 11);
+  UNSERIALIZE_SCALAR(write_unit_bubble);
+  std::vector<int64_t> services;
+  UNSERIALIZE_CONTAINER(services);
+  const int per_unit = NUM_SERVICE_LEVELS * 2 + 5;
+  DSA_CHECK((int) services.size() == per_unit * LOC::TOTAL)
+    << "The memory services differ from the checkpoint!";
+  auto iter = services.begin();
+  for (auto &elem : service) {
+    std::copy(iter, iter + NUM_SERVICE_LEVELS, elem.requests);
+    iter += NUM_SERVICE_LEVELS;
+    std::copy(iter, iter + NUM_SERVICE_LEVELS, elem.latency);
+    iter += NUM_SERVICE_LEVELS;
+    for (auto *field : {&elem.merged, &elem.broken_down, &elem.issue_delay,
+                        &elem.forward_delay, &elem.response_delay}) {
+      *field = *iter++;
+    }
+  }
+  std::vector<int64_t> histograms;
+  UNSERIALIZE_CONTAINER(histograms);
+  DSA_CHECK(histograms.size() == 2 * (Log2Histogram::NUM_BUCKETS + 3))
+    << "The latency distributions differ from the checkpoint!";
+  auto hiter = histograms.begin();
+  for (auto *elem : {&latency_histo, &outstanding_reads}) {
+    std::copy(hiter, hiter + Log2Histogram::NUM_BUCKETS, elem->buckets);
+    hiter += Log2Histogram::NUM_BUCKETS;
+    elem->count = *hiter++;
+    elem->sum = *hiter++;
+    elem->max = *hiter++;
+  }
+}
+
 double Accelerator::averageMemoryLatency() {
   return averageImpl(memory_latency);
 }
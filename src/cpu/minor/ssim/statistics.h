@@ -2,9 +2,13 @@
 
 #include <sys/time.h>
 #include <cstdint>
+#include <ostream>
+#include <unordered_map>
 #include <vector>
 
 #include "cpu/static_inst.hh"
+#include "mem/request.hh"
+#include "sim/serialize.hh"
 
 #include "loc.hh"
 
@@ -18,6 +22,37 @@ namespace stat {
 
 struct Accelerator;
 
+/*!
+ * \brief A distribution in log2 buckets: bucket 0 counts 0, and bucket i counts [2^(i-1), 2^i).
+ *        It is cheap enough to be counted on each response, and keeps the tail, which the
+ *        running sum loses.
+ */
+struct Log2Histogram {
+  static constexpr int NUM_BUCKETS = 32;
+  int64_t buckets[NUM_BUCKETS] = {};
+  int64_t count{0};
+  int64_t sum{0};
+  int64_t max{0};
+  /*!
+   * \brief The bucket of the value. The values beyond the last bucket are counted in it.
+   */
+  static int bucketOf(int64_t value);
+  /*!
+   * \brief The largest value of the bucket.
+   */
+  static int64_t bucketMax(int bucket);
+  /*!
+   * \brief The largest value of the bucket reaching the given fraction of the samples,
+   *        so that the percentile is never under-estimated.
+   * \param buckets The counts of the buckets.
+   * \param p The fraction, e.g. 0.99 for the 99th percentile.
+   */
+  static int64_t percentile(const double *buckets, int n, double p);
+  void add(int64_t value);
+  int64_t percentile(double p) const;
+  double mean() const { return count ? (double) sum / count : 0; }
+};
+
 /*!
  * \brief Statistics of the host controller.
  */
@@ -69,6 +104,11 @@ struct Host {
    * \brief The CPU cycle collapse for simulation.
    */
   double cycleElapsed();
+  /*!
+   * \brief Checkpoint the counters and the ROI status. The wall time is not checkpointed.
+   */
+  void serialize(CheckpointOut &cp) const;
+  void unserialize(CheckpointIn &cp);
 
  private:
   /*!
@@ -112,6 +152,17 @@ struct Accelerator {
   static const char *BlameStr[Blame::UNKNOWN + 1];
   Blame blame{Blame::UNKNOWN};
   int64_t blame_count[Blame::UNKNOWN + 1];
+  /*!
+   * \brief Why the oldest command of this lane cannot be dispatched.
+   */
+  enum DispatchBlock {
+    PORT_BUSY,
+    BUFFER_NON_EMPTY,
+    BARRIER,
+    NUM_DISPATCH_BLOCKS
+  };
+  static const char *DispatchBlockStr[NUM_DISPATCH_BLOCKS];
+  int64_t dispatch_blocked[NUM_DISPATCH_BLOCKS];
   struct Traffic {
     /*!
      * \brief The number of reuqests that caused this traffic
@@ -132,6 +183,78 @@ struct Accelerator {
    */
   int64_t memory_latency{0};
   int64_t mem_lat_brkd[11];
+  /*!
+   * \brief The level of the memory hierarchy which served a read.
+   */
+  enum ServiceLevel {
+    L1,
+    REMOTE_L1,
+    L2,
+    MEMORY,
+    UNKNOWN_LEVEL,
+    NUM_SERVICE_LEVELS
+  };
+  static const char *ServiceLevelStr[NUM_SERVICE_LEVELS];
+  /*!
+   * \brief Where and how long the memory served the reads, in cycles.
+   */
+  struct Service {
+    /*!
+     * \brief The reads served by each level, and the cycles they spent in the memory.
+     */
+    int64_t requests[NUM_SERVICE_LEVELS] = {};
+    int64_t latency[NUM_SERVICE_LEVELS] = {};
+    /*!
+     * \brief The reads merged into another read outstanding to the same line.
+     */
+    int64_t merged{0};
+    /*!
+     * \brief The misses whose latency is broken down by the protocol, and the cycles they spent
+     *        before leaving the L1, before being forwarded, and before the first response.
+     */
+    int64_t broken_down{0};
+    int64_t issue_delay{0};
+    int64_t forward_delay{0};
+    int64_t response_delay{0};
+    /*!
+     * \brief The reads served by all the levels.
+     */
+    int64_t reads() const;
+  };
+  /*!
+   * \brief The service of the reads of each memory unit.
+   */
+  Service service[LOC::TOTAL];
+  /*!
+   * \brief The service of the reads of each stream in flight, by the ID of the stream.
+   */
+  std::unordered_map<int, Service> stream_service;
+  /*!
+   * \brief The retired streams served the most reads, at most WORST_STREAMS of them.
+   */
+  std::vector<std::pair<int, Service>> busiest_stream_service;
+  /*!
+   * \brief The distribution of the DMA read latency in cycles, of the lane, of each stream,
+   *        and of each input port.
+   */
+  Log2Histogram latency_histo;
+  std::unordered_map<int, Log2Histogram> stream_latency;
+  std::unordered_map<int, Log2Histogram> port_latency;
+  /*!
+   * \brief The retired streams with the worst p99 latency, at most WORST_STREAMS of them.
+   *        A stream is folded into them when its port is freed, so that stream_latency and
+   *        stream_service only keep the streams in flight.
+   */
+  static constexpr int WORST_STREAMS = 8;
+  std::vector<std::pair<int, Log2Histogram>> worst_stream_latency;
+  /*!
+   * \brief The DMA reads outstanding, sampled every timeline_interval cycles.
+   */
+  Log2Histogram outstanding_reads;
+  /*!
+   * \brief The bytes buffered in each input port, summed over the samples.
+   */
+  std::vector<int64_t> port_occupancy;
   /*!
    * \brief Write stream bounded by too many write requests.
    */
@@ -153,8 +276,38 @@ struct Accelerator {
   void countDataTraffic(int is_input, LOC unit, int delta);
   /*!
    * \brief Count the memory latency.
+   * \param stream_id The stream of the request.
+   * \param port The input port the response goes to.
+   */
+  void countMemoryLatency(int64_t request_cycle, int64_t *breakdown, int stream_id, int port);
+  /*!
+   * \brief Sample the DMA reads outstanding and the bytes buffered in the input ports.
+   * \param csv Append the sample as a row, if not null.
+   */
+  void sampleTimeline(std::ostream *csv);
+  /*!
+   * \brief Fold the distributions and the service of the stream freed into the bounded ones.
+   */
+  void retireStream(int stream_id);
+  /*!
+   * \brief The streams with the worst p99 latency, among the retired and those in flight,
+   *        the worst first.
+   */
+  std::vector<std::pair<int, const Log2Histogram*>> worstStreams() const;
+  /*!
+   * \brief The streams served the most reads, among the retired and those in flight,
+   *        the busiest first.
+   */
+  std::vector<std::pair<int, const Service*>> busiestStreams() const;
+  /*!
+   * \brief The level which served the request, told by the machine type of the memory.
+   *        The machine types are mapped to the levels once, by their names.
    */
-  void countMemoryLatency(int64_t request_cycle, int64_t *breakdown);
+  static ServiceLevel serviceLevel(const Request::ServiceInfo &info);
+  /*!
+   * \brief Count where and how long the memory served a read of the stream.
+   */
+  void countService(LOC unit, int stream_id, const Request::ServiceInfo &info);
   /*!
    * \brief Average cycles of memory response latency.
    */
@@ -167,10 +320,25 @@ struct Accelerator {
    * \brief Cycle breakdown.
    */
   void blameCycle();
+  /*!
+   * \brief Blame the cycles skipped when the accelerator is quiescent.
+   *        The reason of the last ticked cycle holds for all of them.
+   * \param cycles The number of cycles skipped.
+   */
+  void blameSkippedCycles(int64_t cycles);
+  /*!
+   * \brief Count a cycle the commands of this lane are blocked from dispatching.
+   */
+  void blockDispatch(DispatchBlock reason);
   /*!
    * \brief Count memory write bounded by TLB transfer.
    */
   int64_t memoryWriteBoundByXfer(bool inc = false);
+  /*!
+   * \brief Checkpoint the counters.
+   */
+  void serialize(CheckpointOut &cp) const;
+  void unserialize(CheckpointIn &cp);
 
   double averageImpl(int64_t);
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <limits>
 #include <numeric>
 #include <functional>
@@ -7,91 +8,8 @@
 #include "stream.hh"
 #include "sim-debug.hh"
 
-const char *LOC_NAME[] = {
-#define MACRO(x) #x
-#include "loc.def"
-#undef MACRO
-};
-
 int base_stream_t::ID_SOURCE = 0;
 
-#define CQ_PTR(x, delta)               \
-  do {                                 \
-    x += (delta);                      \
-    if (x >= end) {                    \
-      x = begin + (x) - end;           \
-      DSA_CHECK(x >= begin && x <= end);   \
-    }                                  \
-  } while (false)
-
-bool BuffetEntry::EnforceReadWrite(int64_t addr, int word) {
-  if (mo == MemoryOperation::DMO_Read) {
-    return InRange(addr);
-  } else if (mo == MemoryOperation::DMO_Write) {
-    return addr >= address && addr < address + Size();
-  }
-  DSA_CHECK(false) << "Not supported yet!";
-  return false;
-}
-
-int64_t BuffetEntry::Translate(int64_t addr, MemoryOperation mo) {
-  switch (mo) {
-  case DMO_Write:
-    DSA_CHECK(SpaceAvailable() && addr == address + occupied)
-      << "For now only appended writing is supported!"
-      << "request: " << addr << ", address: [" << address << ", " << address + occupied << ")"
-      << ", Size: " << Size();
-    break;
-  case DMO_Read:
-    DSA_CHECK(InRange(addr))
-      << "Address out of range: " << addr << " not in ["
-      << address << ", " << address + occupied << ")";
-    break;
-  default:
-    DSA_CHECK(false) << "Not supported: " << mo;
-  }
-  CQ_PTR(addr, front - address);
-  return addr;
-}
-
-void BuffetEntry::Append(int bytes) {
-  DSA_CHECK(occupied + bytes <= Size())
-    << "Buffet size overflow!" << occupied << " " << bytes << " " << Size();
-  occupied += bytes;
-  CQ_PTR(tail, bytes);
-  if (bytes) {
-    DSA_LOG(BUFFET) << "Append " << bytes << ", now: " << toString();
-  }
-}
-
-void BuffetEntry::Shrink(int bytes) {
-  DSA_CHECK(occupied - bytes >= 0)
-    << "Buffet size underflow!" << occupied << " " << bytes << " " << Size();
-  occupied -= bytes;
-  address += bytes;
-  CQ_PTR(front, bytes);
-  if (bytes) {
-    DSA_LOG(BUFFET) << "Pop " << bytes << ", now: " << toString();
-  }
-}
-
-#undef CQ_PTR
-
-int BuffetEntry::SpaceAvailable() {
-  int64_t res = 0;
-  if (front < tail) {
-    res = tail - front;
-  } else {
-    res = (end - front) + (tail - begin);
-  }
-  if (res != occupied) {
-    DSA_CHECK(occupied == 0 || occupied == end - begin)
-      << occupied << " ? " << end - begin << " | "
-      << front << ", " << tail;
-  }
-  return Size() - occupied;
-}
-
 void base_stream_t::set_mem_map_config() {
   if(_part_size==0) return;
   _part_bits = log2(_part_size);
@@ -99,15 +17,6 @@ void base_stream_t::set_mem_map_config() {
 
 }
 
-std::string BuffetEntry::toString() {
-  std::ostringstream oss;
-  oss << "Alloc: [" << begin << ", " << end << "), Ptr: ["
-      << front << ", " << tail << "), Buffered: [" << address
-      << ", " << address + occupied << "), occupied: "
-      << occupied << ", space: " << SpaceAvailable();
-  return oss.str();
-}
-
 // based on memory mapping, extract these two information
 uint64_t base_stream_t::get_core_id(addr_t logical_addr) {
   if(_part_size==0) return logical_addr/SCRATCH_SIZE;
@@ -271,72 +180,6 @@ namespace dsa {
 namespace sim {
 namespace stream {
 
-int LinearStream::LineInfo::bytes_read() const {
-  return std::accumulate(mask.begin(), mask.end(), 0, std::plus<int>());
-}
-
-LinearStream::LineInfo Linear1D::cacheline(int bandwidth, int at_most, BuffetEntry *be,
-                                           MemoryOperation mo, LOC loc) {
-  DSA_CHECK(hasNext());
-  AffineStatus as;
-  as.stream_1st = i == 0;
-  as.dim_1st = i == 0 ? 1 : 0;
-  std::vector<bool> mask(bandwidth, 0);
-  DSA_CHECK(bandwidth == (bandwidth & -bandwidth));
-  int64_t head = poll(false);
-  if (be) {
-    head = be->Translate(head, mo);
-  }
-  int64_t base = ~(bandwidth - 1) & head;
-  DSA_LOG(LI) << "Head: " << head << ", Base: " << base;
-  int64_t cnt = 0;
-  int64_t current = -1;
-  int64_t untranslated = -1;
-  int64_t prev = -1;
-  while (cnt < at_most && hasNext()) {
-    prev = current;
-    untranslated = current = poll(false);
-    if (be && !be->EnforceReadWrite(current, word)) {
-      DSA_LOG(LI) << "Cannot write to buffet!";
-      break;
-    }
-    if (be) {
-      current = be->Translate(current, mo);
-      prev = current;
-    }
-    DSA_CHECK(current >= base);
-    if (current < base + bandwidth) {
-      DSA_LOG(LI) << "Address: " << current << " x " << word;
-      if (mo != DMO_Read && loc == LOC::DMA && (prev != -1 && current - prev != word)) {
-        DSA_LOG(LI) << "Break by incontinuous write!";
-        break;
-      }
-      if (be) {
-        if (be->mo == DMO_Write) {
-          // Commit buffet append here.
-          be->Append(word);
-        }
-      }
-      for (int j = 0, n = abs(word); j < n; ++j) {
-        DSA_CHECK(current - base + j >= 0 && current - base + j < mask.size())
-          << current << " - " << base << " + " << j << " = "
-          << current - base + j << " not in [0, " << mask.size() << ")";
-        mask[(current - base) + j] = true;
-        ++cnt;
-      }
-      poll(true); // pop the current one
-    } else {
-      DSA_LOG(LI) << "Break by bandwidth: " << current << " >= " << base << " + " << bandwidth;
-      break;
-    }
-  }
-  DSA_LOG(SHRINK) << "shrink: " << untranslated + word;
-  as.dim_last = i == length ? 1 : 0;
-  as.n = length * word;
-  as.stream_last = !hasNext();
-  return LineInfo(base, head, mask, untranslated + word, as);
-}
-
 void Functor::Visit(base_stream_t *) {}
 
 void Functor::Visit(IPortStream *is) {
@@ -608,29 +451,6 @@ std::string IndirectFSM::toString(accel_t *accel) {
   return oss.str();
 }
 
-uint8_t AffineStatus::toTag(bool packet_1st, bool packet_last) const {
-  int res = 0;
-  int mask_1st = (1 << dim_1st) - 1;
-  int mask_last = (1 << dim_last) - 1;
-  res = (res << 1) | (((mask_last & 2) >> 1) && packet_last); // L2D end, MSB
-  res = (res << 1) | (((mask_1st & 2) >> 1) && packet_1st);   // L2D 1st
-  res = (res << 1) | ((mask_last & 1) && packet_last);        // L1D end
-  res = (res << 1) | ((mask_1st & 1) && packet_1st);          // L1D 1st
-  res = (res << 1) | (stream_last && packet_last);            // Stream end
-  res = (res << 1) | (stream_1st && packet_1st);              // Stream 1st, LSB
-  DSA_LOG(TAG) << res;
-  return res;
-}
-
-std::string AffineStatus::toString() const {
-  std::ostringstream oss;
-  oss
-    << "dim 1st: " << dim_1st << ", dim last: " << dim_last
-    << ", stream 1st: " << stream_1st << ", stream last: " << stream_last
-    << ", bytes: " << n;
-  return oss.str();
-}
-
 } // namespace stream
 } // namespace sim
 } // namespace dsa
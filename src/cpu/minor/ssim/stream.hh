@@ -15,6 +15,7 @@
 #include "./bitstream.h"
 #include "./linear_stream.h"
 #include "./ism.h"
+#include "./buffet.h"
 
 class accel_t;
 
@@ -77,86 +78,6 @@ BarrierFlag Loc2BarrierFlag(LOC loc);
 }
 }
 
-/*!
- * \brief Bookkeeping information of Buffet streams.
- */
-struct BuffetEntry {
-  /*!
-   * \brief [start, end) address on the scratch pad that is dedicated to
-   *        this buffet stream.
-   */
-  int begin, end;
-  /*!
-   * \brief The window of data buffered by buffet.
-   */
-  int front{0}, tail{0};
-  /*!
-   * \brief The number of elements buffered.
-   */
-  int occupied{0};
-  /*!
-   * \brief The starting address of the data buffered.
-   */
-  int64_t address{0};
-  /*!
-   * \brief Use stream involved by this buffet.
-   */
-  std::vector<base_stream_t*> referencer;
-
-  BuffetEntry(int begin_, int end_) : begin(begin_), end(end_), address(begin_) {}
-
-  /*!
-   * \brief Dump to string for debugging.
-   */
-  std::string toString();
-
-  /*!
-   * \brief The number of bytes allocated for this Buffet.
-   */
-  int Size() {
-    return end - begin;
-  }
-
-  /*!
-   * \brief If we still have space available in the Buffet buffer.
-   */
-  int SpaceAvailable();
-
-  bool InRange(int64_t addr) {
-    return addr >= address && addr < address + occupied;
-  }
-
-  /*!
-   * \brief Translate the requested absolute address to relative address in buffet.
-   */
-  int64_t Translate(int64_t addr, MemoryOperation mo);
-
-  /*!
-   * \brief Append bytes of data to the Buffet FIFO.
-   * \param bytes The number of data to occupy the allocated Buffet space.
-   */
-  void Append(int bytes);
-
-  /*!
-   * \brief Append bytes of data to the Buffet FIFO
-   * \param bytes The number of data to remove from the allocated Buffet space
-   */
-  void Shrink(int bytes);
-
-  /*!
-   * \brief The current memory address on this buffet.
-   */
-  MemoryOperation mo{MemoryOperation::DMO_Unkown};
-
-  /*!
-   * \brief Enforce if the current address can be read/write.
-   * \param addr 
-   * \param word 
-   */
-  bool EnforceReadWrite(int64_t addr, int word);
-
-};
-
 struct base_stream_t {
   static int ID_SOURCE;
 
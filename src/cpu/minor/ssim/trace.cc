@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "dsa/debug.h"
+
+#include "./loc.hh"
+#include "./statistics.h"
+#include "./trace.h"
+
+namespace dsa {
+namespace sim {
+
+TraceSink::TraceSink(const std::string &fname, int capacity) {
+  int cap = 1;
+  while (cap < capacity) {
+    cap <<= 1;
+  }
+  ring.resize(cap);
+  mask = cap - 1;
+  fout = fopen(fname.c_str(), "wb");
+  DSA_CHECK(fout) << "Cannot open trace file " << fname;
+  fprintf(fout, "DSATRACE 1 %d\n", (int) sizeof(TraceRecord));
+  fprintf(fout, "BLAME");
+  for (int i = 0; i <= stat::Accelerator::Blame::UNKNOWN; ++i) {
+    fprintf(fout, " %s", stat::Accelerator::BlameStr[i]);
+  }
+  fprintf(fout, "\nLOC");
+  for (int i = 0; i <= LOC::TOTAL; ++i) {
+    fprintf(fout, " %s", LOC_NAME[i]);
+  }
+  fprintf(fout, "\n\n");
+  writer = std::thread(&TraceSink::Drain, this);
+}
+
+TraceSink::~TraceSink() {
+  stop = true;
+  writer.join();
+  Flush();
+  fclose(fout);
+}
+
+void TraceSink::Push(const TraceRecord &record) {
+  uint64_t h = head.load(std::memory_order_relaxed);
+  // Wait for the writer rather than dropping records.
+  while (h - tail.load(std::memory_order_acquire) > (uint64_t) mask) {
+    std::this_thread::yield();
+  }
+  ring[h & mask] = record;
+  head.store(h + 1, std::memory_order_release);
+  ++records;
+}
+
+bool TraceSink::Flush() {
+  uint64_t t = tail.load(std::memory_order_relaxed);
+  uint64_t h = head.load(std::memory_order_acquire);
+  if (t == h) {
+    return false;
+  }
+  // Write the ring in at most two contiguous pieces.
+  uint64_t first = std::min<uint64_t>(h - t, ring.size() - (t & mask));
+  fwrite(&ring[t & mask], sizeof(TraceRecord), first, fout);
+  fwrite(&ring[0], sizeof(TraceRecord), h - t - first, fout);
+  tail.store(h, std::memory_order_release);
+  return true;
+}
+
+void TraceSink::Drain() {
+  while (!stop.load(std::memory_order_acquire)) {
+    if (!Flush()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+}
+
+namespace {
+
+TraceRecord MakeRecord(TraceEvent event, uint64_t cycle, int lane, int stream, int port, int loc) {
+  TraceRecord res;
+  memset(&res, 0, sizeof(res));
+  res.event = event;
+  res.cycle = cycle;
+  res.lane = lane;
+  res.stream = stream;
+  res.port = port;
+  res.loc = loc;
+  return res;
+}
+
+int64_t AwaitingKey(int stream, int port) {
+  return (int64_t) stream << 16 | (uint16_t) port;
+}
+
+}
+
+void TraceSink::Issue(uint64_t cycle, int lane, int stream, int port, int loc) {
+  awaiting.insert(AwaitingKey(stream, port));
+  Push(MakeRecord(TE_ISSUE, cycle, lane, stream, port, loc));
+}
+
+void TraceSink::Request(uint64_t cycle, int lane, int stream, int port, int loc,
+                        uint64_t addr, int bytes, bool read) {
+  auto record = MakeRecord(TE_REQUEST, cycle, lane, stream, port, loc);
+  record.addr = addr;
+  record.bytes = bytes;
+  record.aux = read;
+  Push(record);
+}
+
+void TraceSink::Response(uint64_t cycle, int lane, int stream, int port, int loc,
+                         uint64_t addr, int bytes) {
+  auto record = MakeRecord(TE_RESPONSE, cycle, lane, stream, port, loc);
+  record.addr = addr;
+  record.bytes = bytes;
+  if (awaiting.erase(AwaitingKey(stream, port))) {
+    record.event = TE_FIRST_BYTE;
+    Push(record);
+    record.event = TE_RESPONSE;
+  }
+  Push(record);
+}
+
+void TraceSink::Retire(uint64_t cycle, int lane, int stream, int port, int loc) {
+  awaiting.erase(AwaitingKey(stream, port));
+  Push(MakeRecord(TE_RETIRE, cycle, lane, stream, port, loc));
+}
+
+void TraceSink::Blame(uint64_t cycle, int lane, int blame) {
+  if (lane >= (int) last_blame.size()) {
+    last_blame.resize(lane + 1, -1);
+  }
+  if (last_blame[lane] == blame) {
+    return;
+  }
+  last_blame[lane] = blame;
+  auto record = MakeRecord(TE_BLAME, cycle, lane, -1, 0, 0);
+  record.aux = blame;
+  Push(record);
+}
+
+void TraceSink::Roi(uint64_t cycle, bool enter) {
+  // Blames are accounted from scratch in each region.
+  last_blame.assign(last_blame.size(), -1);
+  auto record = MakeRecord(TE_ROI, cycle, 0, -1, 0, 0);
+  record.aux = enter;
+  Push(record);
+}
+
+}
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace dsa {
+namespace sim {
+
+/*!
+ * \brief The events in the lifetime of a stream, plus the accounting of cycles.
+ */
+enum TraceEvent : uint8_t {
+  /*! \brief A stream is bound to a port. */
+  TE_ISSUE,
+  /*! \brief The first data of a stream arrives at a port. */
+  TE_FIRST_BYTE,
+  /*! \brief A line is requested from the memory. aux: 1 for read, 0 for write. */
+  TE_REQUEST,
+  /*! \brief A line comes back from the memory to a port. */
+  TE_RESPONSE,
+  /*! \brief A stream is freed from a port. */
+  TE_RETIRE,
+  /*! \brief The blamed reason of a lane changes. aux: the Blame. */
+  TE_BLAME,
+  /*! \brief The region of interest is entered (aux 1) or exited (aux 0). */
+  TE_ROI,
+};
+
+/*!
+ * \brief A trace record of fixed size, written as is to the trace file.
+ */
+struct TraceRecord {
+  uint64_t cycle;
+  uint64_t addr;
+  int32_t stream;
+  uint16_t bytes;
+  uint16_t port;
+  uint8_t event;
+  uint8_t lane;
+  uint8_t loc;
+  uint8_t aux;
+  uint8_t reserved[4];
+};
+
+static_assert(sizeof(TraceRecord) == 32, "The trace record should be compact!");
+
+/*!
+ * \brief The binary trace of stream lifetimes. The simulator thread appends records to
+ *        a single-producer single-consumer ring, and a writer thread drains them to the file.
+ *        When tracing is off, no sink is built, and each hook costs a null check.
+ *        The file starts with a text header ending with an empty line, which names the
+ *        blame reasons and memory units, followed by the records.
+ *        Use util/decode_dsa_trace.py to analyze it.
+ */
+struct TraceSink {
+  /*!
+   * \param fname The file to write.
+   * \param capacity The records buffered in the ring, rounded up to a power of 2.
+   */
+  TraceSink(const std::string &fname, int capacity = 1 << 16);
+
+  ~TraceSink();
+
+  void Issue(uint64_t cycle, int lane, int stream, int port, int loc);
+
+  void Request(uint64_t cycle, int lane, int stream, int port, int loc,
+               uint64_t addr, int bytes, bool read);
+  /*!
+   * \brief A response arrives at the port. The first response of each stream on each port
+   *        is also recorded as its first byte.
+   */
+  void Response(uint64_t cycle, int lane, int stream, int port, int loc, uint64_t addr, int bytes);
+
+  void Retire(uint64_t cycle, int lane, int stream, int port, int loc);
+  /*!
+   * \brief Record the blamed reason of the lane in this cycle, only if it changes.
+   */
+  void Blame(uint64_t cycle, int lane, int blame);
+
+  void Roi(uint64_t cycle, bool enter);
+
+  /*!
+   * \brief The number of records written.
+   */
+  int64_t records{0};
+
+ private:
+  void Push(const TraceRecord &record);
+  /*!
+   * \brief The loop of the writer thread.
+   */
+  void Drain();
+  /*!
+   * \brief Write the records in the ring to the file.
+   * \return If any record is written.
+   */
+  bool Flush();
+
+  FILE *fout;
+  std::vector<TraceRecord> ring;
+  int mask;
+  /*!
+   * \brief The next record to write by the producer, and to drain by the consumer.
+   */
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+  std::atomic<bool> stop{false};
+  std::thread writer;
+  /*!
+   * \brief The (stream, port) pairs whose first byte is not arrived yet.
+   */
+  std::unordered_set<int64_t> awaiting;
+  /*!
+   * \brief The last blame recorded of each lane.
+   */
+  std::vector<int> last_blame;
+};
+
+}
+}
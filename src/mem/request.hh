@@ -402,7 +402,8 @@ class Request
           _pc(other._pc), _reqInstSeqNum(other._reqInstSeqNum),
           _localAccessor(other._localAccessor),
           translateDelta(other.translateDelta),
-          accessDelta(other.accessDelta), depth(other.depth)
+          accessDelta(other.accessDelta), depth(other.depth),
+          service(other.service)
     {
         atomicOpFunctor.reset(other.atomicOpFunctor ?
                                 other.atomicOpFunctor->clone() : nullptr);
@@ -456,6 +457,7 @@ class Request
         depth = 0;
         accessDelta = 0;
         translateDelta = 0;
+        service = ServiceInfo();
         atomicOpFunctor = std::move(amo_op);
         _localAccessor = nullptr;
     }
@@ -531,6 +533,34 @@ class Request
      */
     mutable int depth = 0;
 
+    /**
+     * Where and how long the memory system served this request, filled in
+     * by the Ruby sequencer, for the requestors to profile their accesses.
+     */
+    struct ServiceInfo
+    {
+        /** The MachineType of the controller which responded, -1 if not
+         *  known, e.g. out of Ruby */
+        int machine = -1;
+        /** If another controller than the first level responded */
+        bool external = false;
+        /** If the request was merged into one outstanding to its line,
+         *  so that it waited for that one instead of being issued */
+        bool merged = false;
+        /** If the miss breakdown below is given by the protocol */
+        bool breakdown = false;
+        /** Ticks from the sequencer to the request leaving the first level */
+        Tick issueDelay = 0;
+        /** Ticks from there to the request forwarded by the directory */
+        Tick forwardDelay = 0;
+        /** Ticks from there to the first response */
+        Tick responseDelay = 0;
+        /** Ticks from the sequencer to the completion */
+        Tick totalDelay = 0;
+    };
+
+    ServiceInfo service;
+
     /**
      *  Accessor for size.
      */
@@ -760,6 +790,12 @@ class Request
     void incAccessDepth() const { depth++; }
     int getAccessDepth() const { return depth; }
 
+    /**
+     * Set/Get where and how long the memory system served this request.
+     */
+    void setServiceInfo(const ServiceInfo &info) { service = info; }
+    const ServiceInfo &getServiceInfo() const { return service; }
+
     /**
      * Set/Get the time taken for this request to be successfully translated.
      */
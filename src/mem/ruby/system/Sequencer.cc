@@ -327,6 +327,42 @@ Sequencer::recordMissLatency(SequencerRequest* srequest, bool llscSuccess,
     }
 }
 
+void
+Sequencer::recordServiceInfo(SequencerRequest* srequest, bool merged,
+                             const MachineType respondingMach,
+                             bool isExternalHit, Cycles initialRequestTime,
+                             Cycles forwardRequestTime,
+                             Cycles firstResponseTime)
+{
+    Cycles issued_time = srequest->issue_time;
+    Cycles completion_time = curCycle();
+
+    Request::ServiceInfo info;
+    // A hit in the first level gives no responding machine
+    info.machine = respondingMach == MachineType_NUM ?
+        (int) m_controller->getType() : (int) respondingMach;
+    info.external = isExternalHit;
+    info.merged = merged;
+    info.totalDelay = cyclesToTicks(completion_time - issued_time);
+
+    // Only the requests issued to the network themselves are broken down,
+    // the same as recordMissLatency
+    if (!merged && isExternalHit &&
+        (issued_time <= initialRequestTime) &&
+        (initialRequestTime <= forwardRequestTime) &&
+        (forwardRequestTime <= firstResponseTime) &&
+        (firstResponseTime <= completion_time)) {
+        info.breakdown = true;
+        info.issueDelay = cyclesToTicks(initialRequestTime - issued_time);
+        info.forwardDelay =
+            cyclesToTicks(forwardRequestTime - initialRequestTime);
+        info.responseDelay =
+            cyclesToTicks(firstResponseTime - forwardRequestTime);
+    }
+
+    srequest->pkt->req->setServiceInfo(info);
+}
+
 void
 Sequencer::writeCallbackScFail(Addr address, DataBlock& data)
 {
@@ -403,6 +439,9 @@ Sequencer::writeCallback(Addr address, DataBlock& data,
             } else {
                 aliased_stores++;
             }
+            recordServiceInfo(&seq_req, !ruby_request, mach, externalHit,
+                              initialRequestTime, forwardRequestTime,
+                              firstResponseTime);
             markRemoved();
             ruby_request = false;
             hitCallback(&seq_req, data, success, mach, externalHit,
@@ -411,6 +450,9 @@ Sequencer::writeCallback(Addr address, DataBlock& data,
         } else {
             // handle read request
             assert(!ruby_request);
+            recordServiceInfo(&seq_req, true, mach, externalHit,
+                              initialRequestTime, forwardRequestTime,
+                              firstResponseTime);
             markRemoved();
             ruby_request = false;
             aliased_loads++;
@@ -468,6 +510,9 @@ Sequencer::readCallback(Addr address, DataBlock& data,
                               initialRequestTime, forwardRequestTime,
                               firstResponseTime);
         }
+        recordServiceInfo(&seq_req, !ruby_request, mach, externalHit,
+                          initialRequestTime, forwardRequestTime,
+                          firstResponseTime);
         markRemoved();
         ruby_request = false;
         hitCallback(&seq_req, data, true, mach, externalHit,
@@ -195,6 +195,14 @@ class Sequencer : public RubyPort
                            Cycles forwardRequestTime,
                            Cycles firstResponseTime);
 
+    /** Tell the requestor where and how long the request is served, on
+     *  the request itself */
+    void recordServiceInfo(SequencerRequest* srequest, bool merged,
+                           const MachineType respondingMach,
+                           bool isExternalHit, Cycles initialRequestTime,
+                           Cycles forwardRequestTime,
+                           Cycles firstResponseTime);
+
     RequestStatus insertRequest(PacketPtr pkt, RubyRequestType primary_type,
                                 RubyRequestType secondary_type);
 
@@ -0,0 +1,166 @@
+#!/usr/bin/env python
+
+# This script reconstructs the per-stream bandwidth timelines and the blame
+# breakdown of the stream-dataflow accelerator from the binary trace dumped
+# by the simulator (see src/cpu/minor/ssim/trace.h), when "trace_file" is
+# given in $DSA_SPEC.
+
+from __future__ import print_function
+
+import argparse
+import collections
+import struct
+import sys
+
+# Keep these in sync with TraceEvent and TraceRecord in ssim/trace.h.
+EVENTS = ['ISSUE', 'FIRST_BYTE', 'REQUEST', 'RESPONSE', 'RETIRE', 'BLAME', 'ROI']
+RECORD = struct.Struct('<QQiHHBBBB4x')
+
+
+def parse(fname):
+    with open(fname, 'rb') as f:
+        magic = f.readline().split()
+        if len(magic) != 3 or magic[0] != b'DSATRACE':
+            sys.exit('%s is not a DSA trace!' % fname)
+        if int(magic[2]) != RECORD.size:
+            sys.exit('Record size %s mismatches the decoder %d!' % (magic[2], RECORD.size))
+        names = {}
+        while True:
+            line = f.readline().split()
+            if not line:
+                break
+            names[line[0].decode()] = [i.decode() for i in line[1:]]
+        records = []
+        while True:
+            raw = f.read(RECORD.size)
+            if len(raw) < RECORD.size:
+                break
+            records.append(RECORD.unpack(raw))
+    return names, records
+
+
+class Stream(object):
+
+    def __init__(self, sid, lane):
+        self.sid = sid
+        self.lane = lane
+        self.ports = set()
+        self.loc = None
+        self.issue = None
+        self.first_byte = None
+        self.retire = None
+        self.requests = 0
+        self.requested = 0
+        self.responded = 0
+        # cycle -> bytes responded to, or requested to write by, this stream
+        self.traffic = collections.Counter()
+
+
+def streams_of(names, records):
+    streams = {}
+    for cycle, addr, sid, nbytes, port, event, lane, loc, aux in records:
+        if sid < 0:
+            continue
+        key = (lane, sid)
+        if key not in streams:
+            streams[key] = Stream(sid, lane)
+        s = streams[key]
+        ev = EVENTS[event]
+        if ev == 'ISSUE':
+            s.ports.add(port)
+            s.loc = names['LOC'][loc]
+            s.issue = cycle if s.issue is None else min(s.issue, cycle)
+        elif ev == 'FIRST_BYTE':
+            s.first_byte = cycle if s.first_byte is None else min(s.first_byte, cycle)
+        elif ev == 'REQUEST':
+            s.requests += 1
+            s.requested += nbytes
+            if not aux:
+                s.traffic[cycle] += nbytes
+        elif ev == 'RESPONSE':
+            s.responded += nbytes
+            s.traffic[cycle] += nbytes
+        elif ev == 'RETIRE':
+            s.retire = cycle if s.retire is None else max(s.retire, cycle)
+    return streams
+
+
+def blame_of(names, records):
+    """Sum up the cycles of each blamed reason of each lane within the ROIs."""
+    res = collections.defaultdict(collections.Counter)
+    current = {}
+    in_roi = False
+    for cycle, addr, sid, nbytes, port, event, lane, loc, aux in records:
+        ev = EVENTS[event]
+        if ev == 'ROI':
+            for l, (since, blame) in current.items():
+                if in_roi:
+                    res[l][blame] += cycle - since
+            current = {}
+            in_roi = bool(aux)
+        elif ev == 'BLAME' and in_roi:
+            if lane in current:
+                since, blame = current[lane]
+                res[lane][blame] += cycle - since
+            current[lane] = (cycle, names['BLAME'][aux])
+    if in_roi and records:
+        last = records[-1][0]
+        for l, (since, blame) in current.items():
+            res[l][blame] += last - since + 1
+    return res
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode the binary stream trace of the DSA simulator.')
+    parser.add_argument('trace', help='The binary trace dumped by the simulator.')
+    parser.add_argument('--window', type=int, default=0,
+                        help='Dump the bandwidth timeline of each stream in '
+                             'windows of this many cycles, as csv.')
+    parser.add_argument('--timeline', default='timeline.csv',
+                        help='The csv file of the bandwidth timeline.')
+    args = parser.parse_args()
+
+    names, records = parse(args.trace)
+    print('%d record(s)' % len(records))
+
+    streams = streams_of(names, records)
+    print('\n%5s %8s %-10s %-8s %10s %10s %10s %8s %10s %10s' %
+          ('lane', 'stream', 'ports', 'unit', 'issue', 'first', 'retire',
+           'requests', 'bytes', 'bytes/cyc'))
+    for key in sorted(streams):
+        s = streams[key]
+        nbytes = sum(s.traffic.values())
+        span = None
+        if s.issue is not None and s.retire is not None:
+            span = s.retire - s.issue + 1
+        print('%5d %8d %-10s %-8s %10s %10s %10s %8d %10d %10s' % (
+            s.lane, s.sid, ','.join(map(str, sorted(s.ports))), s.loc,
+            s.issue, s.first_byte, s.retire, s.requests, nbytes,
+            '%.3f' % (float(nbytes) / span) if span else '-'))
+
+    blames = blame_of(names, records)
+    for lane in sorted(blames):
+        total = sum(blames[lane].values())
+        print('\nLane %d blame breakdown (%d cycles):' % (lane, total))
+        for blame in names['BLAME']:
+            if blames[lane][blame]:
+                print('  %-14s %10d %6.2f%%' % (blame, blames[lane][blame],
+                                               100.0 * blames[lane][blame] / total))
+
+    if args.window:
+        with open(args.timeline, 'w') as f:
+            f.write('lane,stream,window_begin,bytes,bytes_per_cycle\n')
+            for key in sorted(streams):
+                s = streams[key]
+                windows = collections.Counter()
+                for cycle, nbytes in s.traffic.items():
+                    windows[cycle // args.window * args.window] += nbytes
+                for begin in sorted(windows):
+                    f.write('%d,%d,%d,%d,%.3f\n' % (s.lane, s.sid, begin, windows[begin],
+                                                    float(windows[begin]) / args.window))
+        print('\nBandwidth timeline dumped to %s' % args.timeline)
+
+
+if __name__ == '__main__':
+    main()